@@ -0,0 +1,121 @@
+#include "async_query.h"
+#include "fuzzy.h"
+#include "wildcard.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+void collectPostingRefs(const IndexReader &index, const IndexReader *biwords, const QueryNode &node,
+                        vector<PostingRef> &out) {
+    auto add = [&out](const IndexReader &reader, const string &term) {
+        int termId = reader.findTerm(term);
+        if (termId >= 0) out.push_back(PostingRef{&reader, termId});
+    };
+    switch (node.type) {
+        case QueryNodeType::TERM:
+        case QueryNodeType::PHRASE:
+        case QueryNodeType::NEAR:
+            for (const auto &token : node.tokens) add(index, token.first);
+            if (node.type == QueryNodeType::PHRASE && node.slop == 0 && biwords) {
+                for (size_t i = 0; i + 1 < node.tokens.size(); ++i) {
+                    if (node.tokens[i + 1].second != node.tokens[i].second + 1) continue;
+                    add(*biwords, node.tokens[i].first + " " + node.tokens[i + 1].first);
+                }
+            }
+            break;
+        case QueryNodeType::WILDCARD:
+        case QueryNodeType::FUZZY: {
+            TermExpansion expansion = node.type == QueryNodeType::WILDCARD
+                ? expandWildcard(index, node.tokens[0].first)
+                : expandFuzzy(index, node.tokens[0].first, node.slop);
+            for (int termId : expansion.termIds) out.push_back(PostingRef{&index, termId});
+            break;
+        }
+        case QueryNodeType::AND:
+        case QueryNodeType::OR:
+        case QueryNodeType::NOT:
+            for (const auto &child : node.children) collectPostingRefs(index, biwords, *child, out);
+            break;
+    }
+}
+
+namespace {
+
+void prefetch(const vector<PostingRef> &postings) {
+    for (const PostingRef &p : postings) p.index->prefetchPostings(p.termId);
+}
+
+bool resident(const vector<PostingRef> &postings) {
+    for (const PostingRef &p : postings) {
+        if (!p.index->postingsResident(p.termId)) return false;
+    }
+    return true;
+}
+
+// QUERIES WAITING FOR THEIR POSTINGS, OLDEST FIRST
+class Scheduler {
+public:
+    size_t parked() const { return parked_.size(); }
+
+    void park(const vector<PostingRef> *postings, function<void()> resume) {
+        parked_.push_back(Parked{postings, move(resume)});
+    }
+
+    // RESUME EVERY PARKED QUERY WHOSE POSTINGS HAVE ARRIVED; RETURNS HOW MANY
+    size_t resumeReady() {
+        vector<function<void()>> ready;
+        for (size_t i = 0; i < parked_.size();) {
+            if (resident(*parked_[i].postings)) {
+                ready.push_back(move(parked_[i].resume));
+                parked_.erase(parked_.begin() + i);
+            } else {
+                ++i;
+            }
+        }
+        for (auto &resume : ready) resume();
+        return ready.size();
+    }
+
+    // RESUME THE OLDEST QUERY EVEN THOUGH IT WILL FAULT: ITS PAGES HAVE HAD THE LONGEST TO ARRIVE
+    void resumeOldest() {
+        function<void()> resume = move(parked_.front().resume);
+        parked_.pop_front();
+        resume();
+    }
+
+private:
+    struct Parked {
+        const vector<PostingRef> *postings;
+        function<void()> resume;
+    };
+    deque<Parked> parked_;
+};
+
+void startQuery(Scheduler &scheduler, AsyncQuery &query) {
+    if (resident(query.postings)) {
+        query.run();
+    } else {
+        prefetch(query.postings);
+        scheduler.park(&query.postings, query.run);
+    }
+}
+
+} // namespace
+
+void runInterleaved(vector<AsyncQuery> &queries, size_t maxInFlight) {
+    maxInFlight = max<size_t>(1, maxInFlight);
+    Scheduler scheduler;
+    for (AsyncQuery &query : queries) {
+        query.started = chrono::steady_clock::now();
+        startQuery(scheduler, query);
+        scheduler.resumeReady();
+        if (scheduler.parked() >= maxInFlight) scheduler.resumeOldest();
+    }
+    while (scheduler.parked() > 0) {
+        if (scheduler.resumeReady() == 0) scheduler.resumeOldest();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef _ASYNC_QUERY_H_
+#define _ASYNC_QUERY_H_
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <vector>
+#include "binary_index.h"
+#include "query_parser.h"
+
+// INTERLEAVED QUERY EXECUTION FOR AN INDEX THAT IS NOT (ALL) IN MEMORY. A QUERY TOUCHING FIVE TERMS
+// WOULD OTHERWISE STALL ON FIVE PAGE FAULTS IN A ROW. INSTEAD EACH QUERY FIRST ASKS THE OS FOR ALL OF
+// ITS POSTING LISTS AT ONCE (madvise WILLNEED), THEN SUSPENDS UNTIL THEY ARE RESIDENT WHILE THE
+// THREAD STARTS OR FINISHES OTHER QUERIES. A QUERY ONLY EVER WAITS ONCE, BEFORE IT RUNS, SO A WAITING
+// QUERY IS SIMPLY ITS run CALLBACK PARKED IN THE SCHEDULER
+
+// ONE POSTING LIST A QUERY WILL READ (WITH THE TERM'S DOC SET, IF IT HAS ONE)
+struct PostingRef {
+    const IndexReader *index;
+    int termId;
+};
+
+// THE POSTING LISTS A PARSED QUERY WILL READ: ITS TERMS, PHRASE AND NEAR TOKENS, WILDCARD / FUZZY
+// EXPANSIONS AND NEGATED TERMS, PLUS THE BIWORD LISTS OF ADJACENT PHRASE PAIRS WHEN biwords IS GIVEN
+void collectPostingRefs(const IndexReader &index, const IndexReader *biwords, const QueryNode &node,
+                        std::vector<PostingRef> &out);
+
+// ONE QUERY OF AN INTERLEAVED RUN: WHAT IT READS, AND HOW TO ANSWER IT ONCE THAT IS IN MEMORY
+struct AsyncQuery {
+    std::vector<PostingRef> postings;
+    std::function<void()> run;
+    std::chrono::steady_clock::time_point started;  // SET WHEN ITS PREFETCH IS ISSUED, FOR LATENCIES
+};
+
+// RUN queries ON THE CALLING THREAD, IN INPUT ORDER EXCEPT THAT A QUERY WHOSE POSTINGS ARE STILL
+// BEING READ LETS LATER ONES GO FIRST. AT MOST maxInFlight QUERIES WAIT FOR I/O AT ONCE; WHEN ALL
+// OF THEM ARE WAITING THE OLDEST RUNS ANYWAY (ITS READS ARE ALREADY UNDER WAY)
+void runInterleaved(std::vector<AsyncQuery> &queries, size_t maxInFlight);
+
+#endif
@@ -0,0 +1,241 @@
+#include "batch_query.h"
+#include "async_query.h"
+#include "json.hpp"
+#include "query_engine.h"
+#include "query_parser.h"
+#include "ranking.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+// ORDERED SO "query" STAYS FIRST IN EACH OUTPUT LINE
+using json = nlohmann::ordered_json;
+using namespace std;
+
+namespace {
+
+// QUERY TEXT AND DOC PATHS ARE RAW BYTES: INVALID UTF-8 IS WRITTEN AS U+FFFD INSTEAD OF THROWING
+string dumpLine(const json &out) {
+    return out.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+string errorResult(const string &queryText, const string &message) {
+    json out;
+    out["query"] = queryText;
+    out["error"] = message;
+    return dumpLine(out);
+}
+
+struct BatchEntry {
+    string query;
+    string resultLine;  // JSON RESULT, FILLED IN BY A WORKER
+    double latencyMs = 0.0;
+};
+
+// LINES STARTING WITH '{' ARE JSONL RECORDS; ANYTHING ELSE IS THE QUERY TEXT ITSELF
+bool readBatchQueries(const string &path, vector<BatchEntry> &entries) {
+    ifstream in(path);
+    if (!in.is_open()) {
+        cerr << "ERROR OPENING QUERY FILE: " << path << endl;
+        return false;
+    }
+    string line;
+    size_t lineNumber = 0;
+    while (getline(in, line)) {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        BatchEntry entry;
+        if (line[0] == '{') {
+            json record = json::parse(line, nullptr, false);
+            if (record.is_discarded() || !record.contains("query") || !record["query"].is_string()) {
+                cerr << "WARNING: SKIPPING BAD QUERY RECORD AT LINE " << lineNumber << " OF " << path << "\n";
+                continue;
+            }
+            entry.query = record["query"].get<string>();
+        } else {
+            entry.query = line;
+        }
+        entries.push_back(move(entry));
+    }
+    return true;
+}
+
+// start: WHEN THE QUERY WAS TAKEN UP, EARLIER THAN NOW IF IT WAITED FOR ITS POSTINGS
+void runOne(const IndexReader &index, const DocTable &docTable, const BatchOptions &options, ResultCache *cache,
+            PostingCache *postingCache, BatchEntry &entry,
+            chrono::steady_clock::time_point start = chrono::steady_clock::now()) {
+    // A FAILING QUERY BECOMES AN ERROR LINE; AN EXCEPTION ESCAPING A POOL TASK WOULD END THE WHOLE BATCH
+    try {
+        entry.resultLine = answerQuery(index, docTable, entry.query, options.mode, cache, postingCache, options.biwords);
+    } catch (const exception &e) {
+        entry.resultLine = errorResult(entry.query, string("QUERY FAILED: ") + e.what());
+    }
+    entry.latencyMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+// ANSWER entries[begin, end) ON THE CALLING THREAD, INTERLEAVING QUERIES THAT WAIT FOR POSTING I/O
+void runInterleavedRange(const IndexReader &index, const DocTable &docTable, const BatchOptions &options,
+                         ResultCache *cache, PostingCache *postingCache, vector<BatchEntry> &entries, size_t begin,
+                         size_t end) {
+    bool commonGrams = (index.flags() & BINARY_INDEX_FLAG_COMMON_GRAMS) != 0;
+    vector<AsyncQuery> queries(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+        AsyncQuery &query = queries[i - begin];
+        string error;
+        try {
+            auto parsed = parseQuery(entries[i].query, error, commonGrams);
+            if (parsed) collectPostingRefs(index, options.biwords, *parsed, query.postings);
+        } catch (const exception &) {
+            query.postings.clear();  // NOTHING TO PREFETCH; runOne REPORTS THE ERROR
+        }
+        BatchEntry &entry = entries[i];
+        query.run = [&index, &docTable, &options, cache, postingCache, &entry, &query] {
+            runOne(index, docTable, options, cache, postingCache, entry, query.started);
+        };
+    }
+    try {
+        runInterleaved(queries, options.inFlight);
+    } catch (const exception &e) {
+        for (size_t i = begin; i < end; ++i) {
+            if (entries[i].resultLine.empty()) {
+                entries[i].resultLine = errorResult(entries[i].query, string("QUERY FAILED: ") + e.what());
+            }
+        }
+    }
+}
+
+// NEAREST-RANK PERCENTILE OF SORTED VALUES
+double percentile(const vector<double> &sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * sorted.size() + 0.999999);
+    return sorted[min(sorted.size(), max<size_t>(rank, 1)) - 1];
+}
+
+} // namespace
+
+string answerQuery(const IndexReader &index, const DocTable &docTable, const string &queryText, const ResultMode &mode,
+                   ResultCache *cache, PostingCache *postingCache, const IndexReader *biwords,
+                   const ShardOptions &sharding) {
+    json out;
+    out["query"] = queryText;
+
+    string error;
+    auto query = parseQuery(queryText, error, (index.flags() & BINARY_INDEX_FLAG_COMMON_GRAMS) != 0);
+    if (!error.empty()) {
+        out["error"] = error;
+    } else if (!query) {
+        out["matches"] = 0;
+        if (!mode.countOnly) out["results"] = json::array();
+    } else if (mode.countOnly) {
+        // COUNTS ARE NOT CACHED, BUT A CACHED FULL RESULT LIST ANSWERS ONE
+        vector<ScoredDoc> results;
+        if (cache && cache->lookup(resultCacheKey(*query, 0), index.generation(), results)) {
+            out["matches"] = results.size();
+        } else {
+            out["matches"] = countQueryMatches(index, *query, postingCache, biwords);
+        }
+    } else {
+        // UNRANKED RESULTS ARE CACHED AS DOCS WITH A ZERO SCORE
+        vector<ScoredDoc> results;
+        string key = cache ? resultCacheKey(*query, mode.topK, mode.firstN) : string();
+        if (!cache || !cache->lookup(key, index.generation(), results)) {
+            if (mode.topK > 0) {
+                RankStats stats;
+                results = executeRankedQuery(index, *query, mode.topK, stats, postingCache, biwords);
+            } else {
+                vector<int> ids = mode.firstN > 0
+                    ? executeQueryFirst(index, *query, mode.firstN, postingCache, biwords)
+                    : executeQuerySharded(index, *query, sharding, postingCache, biwords);
+                for (int id : ids) results.push_back({id, 0.0f});
+            }
+            if (cache) cache->insert(key, index.generation(), results);
+        }
+
+        json paths = json::array();
+        for (const ScoredDoc &r : results) {
+            if (mode.topK > 0) paths.push_back({{"path", docTable.path(r.docId)}, {"score", r.score}});
+            else paths.push_back(docTable.path(r.docId));
+        }
+        out["matches"] = results.size();
+        out["results"] = move(paths);
+    }
+    return dumpLine(out);
+}
+
+void printCacheStats(const ResultCache *cache, const PostingCache *postingCache) {
+    if (cache) {
+        ResultCacheStats stats = cache->stats();
+        cout << "RESULT CACHE: " << stats.hits << " HITS / " << stats.hits + stats.misses << " LOOKUPS ("
+             << stats.hitRate() * 100.0 << "%), " << stats.entries << " ENTRIES, " << stats.bytes << " BYTES, "
+             << stats.evictions << " EVICTED, " << stats.rejected << " NOT ADMITTED\n";
+    }
+    if (postingCache) {
+        PostingCacheStats stats = postingCache->stats();
+        cout << "POSTING CACHE: " << stats.hits << " HITS / " << stats.hits + stats.misses << " HOT-TERM LOOKUPS ("
+             << stats.hitRate() * 100.0 << "%), " << stats.entries << " LISTS, " << stats.bytes << " BYTES, "
+             << stats.evictions << " EVICTED\n";
+    }
+}
+
+bool runQueryBatch(const IndexReader &index, const DocTable &docTable, const BatchOptions &options) {
+    vector<BatchEntry> entries;
+    if (!readBatchQueries(options.queriesFile, entries)) return false;
+
+    unique_ptr<ResultCache> cache;
+    if (options.cacheBytes > 0) cache = make_unique<ResultCache>(options.cacheBytes);
+    unique_ptr<PostingCache> postingCache;
+    if (options.postingCacheBytes > 0) postingCache = make_unique<PostingCache>(options.postingCacheBytes);
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.numThreads);
+        ResultCache *sharedCache = cache.get();
+        PostingCache *sharedPostings = postingCache.get();
+        if (options.inFlight > 0) {
+            // ONE CONTIGUOUS SHARE PER THREAD
+            size_t share = (entries.size() + pool.size() - 1) / pool.size();
+            for (size_t begin = 0; begin < entries.size(); begin += share) {
+                size_t end = min(entries.size(), begin + share);
+                pool.submit([&index, &docTable, &options, sharedCache, sharedPostings, &entries, begin, end] {
+                    runInterleavedRange(index, docTable, options, sharedCache, sharedPostings, entries, begin, end);
+                });
+            }
+        } else {
+            for (BatchEntry &entry : entries) {
+                pool.submit([&index, &docTable, &options, sharedCache, sharedPostings, &entry] {
+                    runOne(index, docTable, options, sharedCache, sharedPostings, entry);
+                });
+            }
+        }
+        pool.wait();
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    ofstream out(options.outFile);
+    if (!out.is_open()) {
+        cerr << "ERROR OPENING BATCH OUTPUT FILE: " << options.outFile << endl;
+        return false;
+    }
+    for (const BatchEntry &entry : entries) out << entry.resultLine << "\n";
+    out.close();
+
+    vector<double> latencies;
+    latencies.reserve(entries.size());
+    for (const BatchEntry &entry : entries) latencies.push_back(entry.latencyMs);
+    sort(latencies.begin(), latencies.end());
+
+    cout << "BATCH RESULTS WRITTEN TO: " << options.outFile << "\n";
+    cout << "RAN " << entries.size() << " QUERIES ON " << max<size_t>(1, options.numThreads) << " THREADS IN "
+         << seconds << " S (" << (seconds > 0 ? entries.size() / seconds : 0.0) << " QPS)\n";
+    cout << "LATENCY MS: P50 " << percentile(latencies, 50) << "  P90 " << percentile(latencies, 90) << "  P99 "
+         << percentile(latencies, 99) << "  MAX " << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+    printCacheStats(cache.get(), postingCache.get());
+    return (bool)out;
+}
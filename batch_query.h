@@ -0,0 +1,46 @@
+#ifndef _BATCH_QUERY_H_
+#define _BATCH_QUERY_H_
+
+#include <cstddef>
+#include <string>
+#include "binary_index.h"
+#include "doc_table.h"
+#include "posting_cache.h"
+#include "result_cache.h"
+#include "sharded_query.h"
+
+// WHAT A QUERY ANSWER CONTAINS
+struct ResultMode {
+    size_t topK = 0;          // 0: UNRANKED BOOLEAN RESULTS
+    size_t firstN = 0;        // UNRANKED: STOP AT THE FIRST firstN MATCHES (0: ALL)
+    bool countOnly = false;   // ONLY "matches", WITHOUT RESULTS
+};
+
+struct BatchOptions {
+    std::string queriesFile;  // ONE QUERY PER LINE, OR JSONL OBJECTS WITH A "query" FIELD
+    std::string outFile;      // ONE JSON RESULT PER INPUT QUERY, IN INPUT ORDER
+    size_t numThreads = 1;
+    // > 0: EVERY THREAD INTERLEAVES ITS SHARE OF THE QUERIES, UP TO inFlight OF THEM WAITING FOR
+    // POSTING I/O AT ONCE (async_query.h); FOR INDEXES LARGER THAN MEMORY
+    size_t inFlight = 0;
+    ResultMode mode;
+    size_t cacheBytes = 0;    // RESULT CACHE BUDGET; 0 DISABLES THE CACHE
+    size_t postingCacheBytes = 0;  // DECODED POSTING CACHE BUDGET; 0 DISABLES IT
+    const IndexReader *biwords = nullptr;  // OPTIONAL BIWORD INDEX OF THE SAME BUILD
+};
+
+// ANSWER ONE QUERY AS A JSON LINE (NO NEWLINE): {"query","matches","results"}, OR {"query","error"}.
+// EITHER CACHE MAY BE nullptr. SHARED BY THE BATCH RUNNER AND THE QUERY SERVER; FULL UNRANKED RESULT
+// LISTS ARE SPLIT AS sharding SAYS
+std::string answerQuery(const IndexReader &index, const DocTable &docTable, const std::string &queryText,
+                        const ResultMode &mode, ResultCache *cache, PostingCache *postingCache,
+                        const IndexReader *biwords, const ShardOptions &sharding = ShardOptions());
+
+// PRINT THE HIT COUNTERS OF THE CACHES THAT ARE NOT nullptr
+void printCacheStats(const ResultCache *cache, const PostingCache *postingCache);
+
+// REPLAY A FILE OF QUERIES CONCURRENTLY ON A FIXED THREAD POOL AGAINST THE SHARED READ-ONLY
+// INDEX AND DOC TABLE, THEN REPORT THROUGHPUT (QPS) AND LATENCY PERCENTILES
+bool runQueryBatch(const IndexReader &index, const DocTable &docTable, const BatchOptions &options);
+
+#endif
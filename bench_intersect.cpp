@@ -0,0 +1,80 @@
+// MICROBENCHMARKS FOR THE INTERSECTION KERNELS IN intersect.cpp
+// BUILD: g++ -std=c++17 -O2 bench_intersect.cpp intersect.cpp -o bench_intersect
+// RUN:   ./bench_intersect > bench_output.txt
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <vector>
+#include "intersect.h"
+
+using namespace std;
+
+// SORTED UNIQUE LIST OF n VALUES DRAWN FROM [0, universe)
+static vector<int> makeList(size_t n, int universe, mt19937 &rng) {
+    set<int> values;
+    uniform_int_distribution<int> dist(0, universe - 1);
+    while (values.size() < n) values.insert(dist(rng));
+    return vector<int>(values.begin(), values.end());
+}
+
+// THE ORIGINAL phraseExistsInDoc APPROACH: ONE binary_search PER ELEMENT OF a
+static size_t binarySearchBaseline(const int *a, size_t na, const int *b, size_t nb, int shift, int *out) {
+    size_t count = 0;
+    for (size_t i = 0; i < na; ++i) {
+        if (binary_search(b, b + nb, a[i] + shift)) out[count++] = a[i];
+    }
+    return count;
+}
+
+template <typename Fn>
+static double timeNsPerCall(Fn &&fn, int repeats) {
+    auto start = chrono::steady_clock::now();
+    for (int r = 0; r < repeats; ++r) fn();
+    auto elapsed = chrono::steady_clock::now() - start;
+    return chrono::duration<double, nano>(elapsed).count() / repeats;
+}
+
+int main() {
+    mt19937 rng(42);
+    const int universe = 1 << 24;
+    const size_t shapes[][2] = {{1000, 1000}, {10000, 10000}, {100000, 100000},
+                                {1000, 100000}, {100, 100000}, {10, 1000000}, {10000, 1000000}};
+    const IntersectKernel kernels[] = {IntersectKernel::SCALAR_MERGE, IntersectKernel::GALLOP,
+                                       IntersectKernel::SSE41_BLOCK, IntersectKernel::AVX2_BLOCK,
+                                       IntersectKernel::SSE41_V1, IntersectKernel::AVX2_V3};
+
+    printf("%-16s %10s %10s %14s %10s\n", "kernel", "|a|", "|b|", "ns/call", "matches");
+    for (const auto &shape : shapes) {
+        vector<int> a = makeList(shape[0], universe, rng);
+        vector<int> b = makeList(shape[1], universe, rng);
+        // PLANT SOME MATCHES SO THE OUTPUT PATH IS EXERCISED
+        for (size_t i = 0; i < a.size(); i += 3) b.push_back(a[i] + 1);
+        sort(b.begin(), b.end());
+        b.erase(unique(b.begin(), b.end()), b.end());
+
+        vector<int> out(a.size());
+        int repeats = (int)max<size_t>(3, 20000000 / (a.size() + b.size()));
+        size_t matches = 0;
+
+        double ns = timeNsPerCall([&] {
+            matches = binarySearchBaseline(a.data(), a.size(), b.data(), b.size(), 1, out.data());
+        }, repeats);
+        printf("%-16s %10zu %10zu %14.0f %10zu\n", "binary-search", a.size(), b.size(), ns, matches);
+
+        for (IntersectKernel kernel : kernels) {
+            if (!intersectKernelSupported(kernel)) continue;
+            ns = timeNsPerCall([&] {
+                matches = intersectShiftedWith(kernel, a.data(), a.size(), b.data(), b.size(), 1, out.data());
+            }, repeats);
+            printf("%-16s %10zu %10zu %14.0f %10zu\n", intersectKernelName(kernel), a.size(), b.size(), ns, matches);
+        }
+        ns = timeNsPerCall([&] {
+            matches = intersectShifted(a.data(), a.size(), b.data(), b.size(), 1, out.data());
+        }, repeats);
+        printf("%-16s %10zu %10zu %14.0f %10zu\n\n", "dispatch", a.size(), b.size(), ns, matches);
+    }
+    return 0;
+}
@@ -0,0 +1,438 @@
+#include "binary_index.h"
+#include "ranking.h"
+#include "roaring.h"
+#include "wildcard.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+void encodePostingList(const PostingList &postings, string &out) {
+    size_t df = postings.docIds.size();
+    size_t blockCount = (df + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+    size_t skipStart = out.size();
+    out.resize(skipStart + blockCount * sizeof(SkipEntry));
+    size_t dataStart = out.size();
+
+    int prevDoc = 0;
+    for (size_t b = 0; b < blockCount; ++b) {
+        size_t first = b * POSTING_BLOCK_SIZE;
+        size_t last = min(df, first + POSTING_BLOCK_SIZE);
+
+        SkipEntry skip{};
+        skip.docsOffset = (uint32_t)(out.size() - dataStart);
+        for (size_t i = first; i < last; ++i) {
+            appendVarint(out, (uint32_t)(postings.docIds[i] - prevDoc));
+            appendVarint(out, postings.tf(i));
+            prevDoc = postings.docIds[i];
+        }
+        skip.lastDocId = prevDoc;
+
+        // POSITION DELTAS RESTART AT EVERY DOCUMENT
+        skip.positionsOffset = (uint32_t)(out.size() - dataStart);
+        for (size_t i = first; i < last; ++i) {
+            int prevPos = 0;
+            for (uint32_t k = postings.posStarts[i]; k < postings.posStarts[i + 1]; ++k) {
+                appendVarint(out, (uint32_t)(postings.positions[k] - prevPos));
+                prevPos = postings.positions[k];
+            }
+        }
+        memcpy(&out[skipStart + b * sizeof(SkipEntry)], &skip, sizeof(SkipEntry));
+    }
+}
+
+bool BinaryIndexWriter::open(const string &path) {
+    path_ = path;
+    // READ/WRITE: finish() PATCHES THE SKIP TABLES IN PLACE
+    out_.open(path, ios::in | ios::out | ios::binary | ios::trunc);
+    if (!out_.is_open()) {
+        cerr << "ERROR OPENING BINARY INDEX FOR WRITING: " << path << endl;
+        return false;
+    }
+    // HEADER IS REWRITTEN BY finish() ONCE THE SECTION OFFSETS ARE KNOWN
+    BinaryIndexHeader header{};
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    offset_ = sizeof(header);
+    termPool_.clear();
+    lexicon_.clear();
+    lastTerm_.clear();
+    return true;
+}
+
+void BinaryIndexWriter::pad(size_t alignment) {
+    static const char ZEROS[16] = {0};
+    size_t padding = (alignment - offset_ % alignment) % alignment;
+    out_.write(ZEROS, (streamsize)padding);
+    offset_ += padding;
+}
+
+bool BinaryIndexWriter::addTerm(string_view term, string_view encodedPostings, uint32_t df, uint64_t cf) {
+    if (!lexicon_.empty() && term <= string_view(lastTerm_)) {
+        cerr << "ERROR: TERMS NOT IN SORTED ORDER WHEN WRITING " << path_ << ": \"" << term << "\"\n";
+        return false;
+    }
+    // KEEP SKIP TABLES 4-BYTE ALIGNED
+    pad(4);
+
+    LexiconEntry e{};
+    e.termOffset = termPool_.size();
+    e.termLength = (uint32_t)term.size();
+    e.postingsOffset = offset_;
+    e.postingsBytes = (uint32_t)encodedPostings.size();
+    e.df = df;
+    e.cf = cf;
+    lexicon_.push_back(e);
+    termPool_.append(term);
+    lastTerm_.assign(term);
+
+    out_.write(encodedPostings.data(), (streamsize)encodedPostings.size());
+    offset_ += encodedPostings.size();
+    return true;
+}
+
+bool BinaryIndexWriter::fillMaxScores(const vector<uint32_t> &docLengths, uint64_t totalDocLength) {
+    uint32_t maxDocId = docLengths.empty() ? 0 : (uint32_t)(docLengths.size() - 1);
+    Bm25 bm25(totalDocLength, maxDocId);
+    string buffer;
+    vector<int> docIds;
+    for (LexiconEntry &e : lexicon_) {
+        buffer.resize(e.postingsBytes);
+        out_.seekg((streamoff)e.postingsOffset);
+        out_.read(&buffer[0], (streamsize)buffer.size());
+        if (!out_) return false;
+
+        float idf = bm25.idf(e.df);
+        size_t blockCount = (e.df + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+        const char *data = buffer.data() + blockCount * sizeof(SkipEntry);
+        int prevDoc = 0;
+        uint32_t value;
+        e.maxScore = 0.0f;
+        bool dense = e.df >= POSTING_BLOCK_SIZE && (uint64_t)e.df * DOC_SET_DENSITY >= maxDocId;
+        docIds.clear();
+        for (size_t b = 0; b < blockCount; ++b) {
+            SkipEntry skip;
+            memcpy(&skip, &buffer[b * sizeof(SkipEntry)], sizeof(SkipEntry));
+            size_t blockDocs = min<size_t>(POSTING_BLOCK_SIZE, e.df - b * POSTING_BLOCK_SIZE);
+            const char *p = data + skip.docsOffset;
+            skip.maxScore = 0.0f;
+            for (size_t i = 0; i < blockDocs; ++i) {
+                p = readVarint(p, value);
+                prevDoc += (int)value;
+                if (dense) docIds.push_back(prevDoc);
+                p = readVarint(p, value);
+                uint32_t length = (size_t)prevDoc < docLengths.size() ? docLengths[prevDoc] : 0;
+                skip.maxScore = max(skip.maxScore, bm25.termScore(idf, value, length));
+            }
+            e.maxScore = max(e.maxScore, skip.maxScore);
+            memcpy(&buffer[b * sizeof(SkipEntry)], &skip, sizeof(SkipEntry));
+        }
+        out_.seekp((streamoff)e.postingsOffset);
+        out_.write(buffer.data(), (streamsize)(blockCount * sizeof(SkipEntry)));
+        if (dense) writeDocSet(e, docIds);
+    }
+    out_.seekp((streamoff)offset_);
+    return (bool)out_;
+}
+
+void BinaryIndexWriter::writeDocSet(LexiconEntry &e, const vector<int> &docIds) {
+    string encoded;
+    RoaringBitmap(docIds.data(), docIds.size()).serialize(encoded);
+    out_.seekp((streamoff)offset_);
+    pad(4);
+    e.docSetOffset = offset_;
+    e.docSetBytes = encoded.size();
+    out_.write(encoded.data(), (streamsize)encoded.size());
+    offset_ += encoded.size();
+}
+
+bool BinaryIndexWriter::finish(const vector<uint32_t> &docLengths) {
+    BinaryIndexHeader header{};
+    memcpy(header.magic, BINARY_INDEX_MAGIC, sizeof(header.magic));
+    header.version = BINARY_INDEX_VERSION;
+    header.termCount = lexicon_.size();
+    header.maxDocId = docLengths.empty() ? 0 : docLengths.size() - 1;
+    header.flags = flags_;
+    header.generation = generation_ != 0 ? generation_ : newIndexGeneration();
+
+    // DOC LENGTHS, INCLUDING AN UNUSED SLOT FOR DOC 0
+    pad(4);
+    header.docLengthsOffset = offset_;
+    vector<uint32_t> lengths(docLengths);
+    lengths.resize(header.maxDocId + 1, 0);
+    for (size_t d = 1; d < lengths.size(); ++d) header.totalDocLength += lengths[d];
+    out_.write(reinterpret_cast<const char *>(lengths.data()), (streamsize)(lengths.size() * sizeof(uint32_t)));
+    offset_ += lengths.size() * sizeof(uint32_t);
+
+    if (!fillMaxScores(lengths, header.totalDocLength)) {
+        cerr << "ERROR COMPUTING BM25 BOUNDS AND DOC SETS FOR BINARY INDEX: " << path_ << endl;
+        return false;
+    }
+
+    header.termPoolOffset = offset_;
+    out_.write(termPool_.data(), (streamsize)termPool_.size());
+    offset_ += termPool_.size();
+
+    pad(8);
+    header.lexiconOffset = offset_;
+    out_.write(reinterpret_cast<const char *>(lexicon_.data()), (streamsize)(lexicon_.size() * sizeof(LexiconEntry)));
+    offset_ += lexicon_.size() * sizeof(LexiconEntry);
+
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        cerr << "ERROR WRITING BINARY INDEX: " << path_ << endl;
+        return false;
+    }
+    return true;
+}
+
+uint64_t newIndexGeneration() {
+    return (uint64_t)chrono::system_clock::now().time_since_epoch().count();
+}
+
+bool writeBinaryIndex(const map<string, map<int, vector<int>>> &index, const vector<uint32_t> &docLengths,
+                      const string &outFilename, uint64_t generation, uint32_t flags) {
+    BinaryIndexWriter writer;
+    if (!writer.open(outFilename)) return false;
+    writer.setGeneration(generation);
+    writer.setFlags(flags);
+
+    PostingList postings;
+    string encoded;
+    for (const auto &termEntry : index) {
+        postings.clear();
+        postings.posStarts.push_back(0);
+        uint64_t cf = 0;
+        for (const auto &docEntry : termEntry.second) {
+            postings.docIds.push_back(docEntry.first);
+            postings.positions.insert(postings.positions.end(), docEntry.second.begin(), docEntry.second.end());
+            postings.posStarts.push_back((uint32_t)postings.positions.size());
+            cf += docEntry.second.size();
+        }
+        encoded.clear();
+        encodePostingList(postings, encoded);
+        if (!writer.addTerm(termEntry.first, encoded, (uint32_t)postings.size(), cf)) return false;
+    }
+
+    if (!writer.finish(docLengths)) return false;
+    cout << "BINARY INDEX WRITTEN TO: " << outFilename << "\n";
+    return true;
+}
+
+bool IndexReader::open(const string &path) {
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(BinaryIndexHeader)) {
+        cerr << "ERROR: FILE TOO SMALL TO BE A BINARY INDEX: " << path << endl;
+        return false;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, BINARY_INDEX_MAGIC, sizeof(header_.magic)) != 0) {
+        cerr << "ERROR: NOT A BINARY INDEX FILE: " << path << endl;
+        return false;
+    }
+    if (header_.version != BINARY_INDEX_VERSION) {
+        cerr << "ERROR: UNSUPPORTED BINARY INDEX VERSION " << header_.version << " IN " << path << endl;
+        return false;
+    }
+    if (header_.lexiconOffset + header_.termCount * sizeof(LexiconEntry) > file_.size() ||
+        header_.docLengthsOffset + (header_.maxDocId + 1) * sizeof(uint32_t) > file_.size()) {
+        cerr << "ERROR: TRUNCATED BINARY INDEX: " << path << endl;
+        return false;
+    }
+    termPool_ = file_.data() + header_.termPoolOffset;
+    lexicon_ = reinterpret_cast<const LexiconEntry *>(file_.data() + header_.lexiconOffset);
+    docLengths_ = file_.data() + header_.docLengthsOffset;
+    return true;
+}
+
+int IndexReader::findTerm(string_view t) const {
+    int lo = lowerBound(t);
+    return (lo < termCount() && term(lo) == t) ? lo : -1;
+}
+
+int IndexReader::lowerBound(string_view t) const {
+    int lo = 0, hi = termCount();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (term(mid) < t) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+pair<int, int> IndexReader::prefixRange(string_view prefix) const {
+    int first = lowerBound(prefix);
+    // TERMS STARTING WITH prefix FOLLOW IT DIRECTLY; BINARY SEARCH FOR THE FIRST ONE THAT DOES NOT
+    int lo = first, hi = termCount();
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (term(mid).substr(0, prefix.size()) == prefix) lo = mid + 1;
+        else hi = mid;
+    }
+    return {first, lo};
+}
+
+const TermTrigramIndex &IndexReader::termTrigrams() const {
+    call_once(trigramsOnce_, [this] { trigrams_ = make_shared<const TermTrigramIndex>(*this); });
+    return *trigrams_;
+}
+
+void IndexReader::decodePostings(int termId, PostingList &out, bool withPositions) const {
+    decodePostingsRange(termId, 0, END_DOC, out, withPositions);
+}
+
+void IndexReader::decodePostingsRange(int termId, int firstDoc, int lastDoc, PostingList &out,
+                                      bool withPositions) const {
+    out.clear();
+    const LexiconEntry &e = lexicon_[termId];
+    const char *base = file_.data() + e.postingsOffset;
+    size_t blockCount = (e.df + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+    const char *data = base + blockCount * sizeof(SkipEntry);
+    auto skipAt = [base](size_t block) {
+        SkipEntry skip;
+        memcpy(&skip, base + block * sizeof(SkipEntry), sizeof(SkipEntry));
+        return skip;
+    };
+
+    // FIRST BLOCK THAT CAN HOLD firstDoc
+    size_t first = 0, hi = blockCount;
+    while (first < hi) {
+        size_t mid = first + (hi - first) / 2;
+        if (skipAt(mid).lastDocId < firstDoc) first = mid + 1;
+        else hi = mid;
+    }
+    if (first == 0 && lastDoc == END_DOC) {
+        out.docIds.reserve(e.df);
+        out.posStarts.reserve(e.df + 1);
+        if (withPositions) out.positions.reserve(e.cf);
+    }
+    out.posStarts.push_back(0);
+
+    int prevDoc = first > 0 ? skipAt(first - 1).lastDocId : 0;
+    uint32_t value, tf;
+    for (size_t b = first; b < blockCount && prevDoc < lastDoc; ++b) {
+        SkipEntry skip = skipAt(b);
+        size_t blockDocs = min<size_t>(POSTING_BLOCK_SIZE, e.df - b * POSTING_BLOCK_SIZE);
+        const char *p = data + skip.docsOffset;
+        // POSITIONS FOLLOW ALL (DOC DELTA, TF) PAIRS OF THE BLOCK; BOTH ARE WALKED IN STEP
+        const char *q = data + skip.positionsOffset;
+        for (size_t i = 0; i < blockDocs; ++i) {
+            p = readVarint(p, value);
+            prevDoc += (int)value;
+            if (prevDoc > lastDoc) break;
+            p = readVarint(p, tf);
+            bool keep = prevDoc >= firstDoc;
+            if (keep) {
+                out.docIds.push_back(prevDoc);
+                out.posStarts.push_back(out.posStarts.back() + tf);
+            }
+            if (!withPositions) continue;
+            int prevPos = 0;
+            for (uint32_t k = 0; k < tf; ++k) {
+                q = readVarint(q, value);
+                prevPos += (int)value;
+                if (keep) out.positions.push_back(prevPos);
+            }
+        }
+    }
+}
+
+bool IndexReader::loadDocSet(int termId, RoaringBitmap &out) const {
+    const LexiconEntry &e = lexicon_[termId];
+    if (e.docSetBytes == 0 || e.docSetOffset + e.docSetBytes > file_.size()) return false;
+    return out.deserialize(file_.data() + e.docSetOffset, e.docSetBytes);
+}
+
+bool openBiwordIndex(const string &path, const IndexReader &main, IndexReader &biwords) {
+    ifstream probe(path);
+    if (!probe.is_open()) return false;
+    probe.close();
+    if (!biwords.open(path)) return false;
+    if (!(biwords.flags() & BINARY_INDEX_FLAG_BIWORDS)) {
+        cerr << "WARNING: NOT A BIWORD INDEX, IGNORING: " << path << endl;
+        return false;
+    }
+    if (biwords.generation() != main.generation()) {
+        cerr << "WARNING: BIWORD INDEX IS FROM ANOTHER BUILD, IGNORING: " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+BlockCursor::BlockCursor(const IndexReader &index, int termId) {
+    const LexiconEntry &e = index.entry(termId);
+    base_ = index.termPostings(termId);
+    df_ = e.df;
+    maxScore_ = e.maxScore;
+    blockCount_ = (e.df + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+    data_ = base_ + blockCount_ * sizeof(SkipEntry);
+    if (blockCount_ > 0) loadBlock(0);
+    else block_ = 0;
+}
+
+void BlockCursor::loadBlock(size_t block) {
+    block_ = block;
+    pos_ = 0;
+    count_ = 0;
+    if (block >= blockCount_) return;
+
+    SkipEntry skip = this->skip(block);
+    int prevDoc = block > 0 ? this->skip(block - 1).lastDocId : 0;
+    count_ = min<size_t>(POSTING_BLOCK_SIZE, df_ - block * POSTING_BLOCK_SIZE);
+    const char *p = data_ + skip.docsOffset;
+    uint32_t value;
+    for (size_t i = 0; i < count_; ++i) {
+        p = readVarint(p, value);
+        prevDoc += (int)value;
+        docs_[i] = prevDoc;
+        p = readVarint(p, tfs_[i]);
+    }
+    ++blocksDecoded_;
+}
+
+size_t BlockCursor::findBlock(size_t from, int target) const {
+    if (from >= blockCount_ || skip(from).lastDocId >= target) return from;
+    // GALLOP, THEN BINARY SEARCH THE BRACKETED RANGE (lo IS KNOWN TO BE BELOW target)
+    size_t lo = from, step = 1, hi = from + 1;
+    while (hi < blockCount_ && skip(hi).lastDocId < target) {
+        lo = hi;
+        step <<= 1;
+        hi = lo + step;
+    }
+    hi = min(hi, blockCount_);
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (skip(mid).lastDocId < target) lo = mid;
+        else hi = mid;
+    }
+    return hi;
+}
+
+void BlockCursor::next() {
+    if (++pos_ < count_) return;
+    if (block_ < blockCount_) loadBlock(block_ + 1);
+}
+
+void BlockCursor::advance(int target) {
+    if (doc() >= target) return;
+    size_t block = findBlock(block_, target);
+    if (block != block_) loadBlock(block);
+    while (pos_ < count_ && docs_[pos_] < target) ++pos_;
+}
+
+void BlockCursor::shallowAdvance(int target) {
+    // NEVER BEHIND THE DECODED BLOCK; RESTART FROM IT IF target LIES BEFORE THE SHALLOW BLOCK
+    size_t from = shallow_;
+    if (from < block_ || (from > block_ && skip(from - 1).lastDocId >= target)) from = block_;
+    shallow_ = findBlock(from, target);
+}
+
+int BlockCursor::shallowLastDoc() const {
+    return shallow_ < blockCount_ ? skip(shallow_).lastDocId : END_DOC;
+}
+
+float BlockCursor::shallowMaxScore() const {
+    return shallow_ < blockCount_ ? skip(shallow_).maxScore : 0.0f;
+}
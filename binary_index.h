@@ -0,0 +1,283 @@
+#ifndef _BINARY_INDEX_H_
+#define _BINARY_INDEX_H_
+
+#include <climits>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <cstring>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "mapped_file.h"
+
+// BINARY POSITIONAL INDEX (pos_inverted_index.bin)
+//
+// LAYOUT (ALL INTEGERS LITTLE-ENDIAN):
+//   HEADER       BinaryIndexHeader
+//   POSTINGS     PER TERM: SkipEntry[blockCount] FOLLOWED BY THE BLOCK DATA
+//   DOC LENGTHS  uint32_t[maxDocId + 1] INDEXED BY DOC ID (INDEXED TOKENS PER DOC)
+//   DOC SETS     A SERIALIZED RoaringBitmap (roaring.h) PER DENSE TERM
+//   TERM POOL    CONCATENATED TERM BYTES IN SORTED ORDER
+//   LEXICON      LexiconEntry[termCount] SORTED BY TERM (8-BYTE ALIGNED)
+//
+// POSTINGS ARE GROUPED IN BLOCKS OF POSTING_BLOCK_SIZE DOCUMENTS. A BLOCK STORES VARINT
+// (DOC-ID DELTA, TF) PAIRS FOLLOWED BY THE VARINT POSITION DELTAS OF ALL ITS DOCUMENTS,
+// SO DOC IDS CAN BE DECODED (OR SKIPPED BLOCK BY BLOCK) WITHOUT TOUCHING POSITIONS.
+// EVERY SKIP ENTRY CARRIES THE BLOCK'S MAXIMUM BM25 TERM SCORE AND EVERY LEXICON ENTRY THE
+// TERM'S MAXIMUM, BOTH FILLED IN BY BinaryIndexWriter::finish() ONCE DOC LENGTHS ARE KNOWN.
+// A TERM IN AT LEAST 1 / DOC_SET_DENSITY OF THE DOCS ALSO GETS ITS DOC IDS AS A ROARING DOC SET, SO
+// BOOLEAN QUERIES CAN AND / OR IT WORD BY WORD INSTEAD OF DECODING A LONG LIST; ITS BLOCKS STAY FOR
+// TFS AND POSITIONS.
+
+static const char BINARY_INDEX_MAGIC[8] = {'S', 'P', 'I', 'M', 'I', 'B', 'I', 'N'};
+static const uint32_t BINARY_INDEX_VERSION = 4;
+static const size_t POSTING_BLOCK_SIZE = 128;
+// ABOVE THIS DENSITY A ROARING CONTAINER IS A BITMAP, AT MOST 2 BYTES PER DOC. TERMS WITH FEWER THAN
+// POSTING_BLOCK_SIZE DOCS NEVER GET A DOC SET
+static const uint32_t DOC_SET_DENSITY = 16;
+
+// HEADER FLAGS
+static const uint32_t BINARY_INDEX_FLAG_BIWORDS = 1;       // TERMS ARE "first second" PAIRS OF ADJACENT STEMS
+static const uint32_t BINARY_INDEX_FLAG_COMMON_GRAMS = 2;  // ALSO HOLDS COMMON GRAMS (SEE tokenizer.h)
+
+// SENTINEL DOC ID OF AN EXHAUSTED CURSOR
+static const int END_DOC = INT_MAX;
+
+struct BinaryIndexHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t termCount;
+    uint64_t maxDocId;
+    uint64_t termPoolOffset;
+    uint64_t lexiconOffset;
+    uint64_t docLengthsOffset;
+    uint64_t totalDocLength;  // SUM OF ALL DOC LENGTHS, FOR THE BM25 AVERAGE
+    uint64_t generation;      // UNIQUE PER BUILD; CACHED RESULTS FROM ANOTHER GENERATION ARE STALE
+};
+
+struct LexiconEntry {
+    uint64_t termOffset;      // OFFSET INTO THE TERM POOL
+    uint64_t postingsOffset;  // ABSOLUTE FILE OFFSET OF THE TERM'S SKIP TABLE
+    uint64_t cf;              // TOTAL OCCURRENCES IN THE COLLECTION
+    uint32_t termLength;
+    uint32_t df;              // NUMBER OF DOCUMENTS CONTAINING THE TERM
+    uint32_t postingsBytes;   // SKIP TABLE + BLOCK DATA
+    float maxScore;           // HIGHEST BM25 SCORE OF THE TERM IN ANY DOC
+    uint64_t docSetOffset;    // ABSOLUTE FILE OFFSET OF THE TERM'S ROARING DOC SET
+    uint64_t docSetBytes;     // 0 FOR A SPARSE TERM (NO DOC SET)
+};
+
+struct SkipEntry {
+    int32_t lastDocId;        // LAST DOC ID IN THE BLOCK
+    uint32_t docsOffset;      // OFFSETS RELATIVE TO THE END OF THE SKIP TABLE
+    uint32_t positionsOffset;
+    float maxScore;           // HIGHEST BM25 SCORE OF THE TERM IN THIS BLOCK
+};
+
+// DECODED POSTINGS OF ONE TERM: POSITIONS OF docIds[i] ARE positions[posStarts[i] .. posStarts[i + 1])
+struct PostingList {
+    std::vector<int> docIds;
+    std::vector<uint32_t> posStarts;
+    std::vector<int> positions;
+
+    size_t size() const { return docIds.size(); }
+    uint32_t tf(size_t i) const { return posStarts[i + 1] - posStarts[i]; }
+    void clear() {
+        docIds.clear();
+        posStarts.clear();
+        positions.clear();
+    }
+};
+
+// LEB128 VARINTS
+inline void appendVarint(std::string &out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+inline const char *readVarint(const char *p, uint32_t &value) {
+    uint32_t result = 0;
+    int shift = 0;
+    uint8_t byte;
+    do {
+        byte = static_cast<uint8_t>(*p++);
+        result |= static_cast<uint32_t>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    value = result;
+    return p;
+}
+
+// ENCODE ONE TERM'S POSTINGS (SKIP TABLE + BLOCKS), APPENDING TO out
+void encodePostingList(const PostingList &postings, std::string &out);
+
+// SEQUENTIAL WRITER: POSTINGS ARE STREAMED TO DISK, THE LEXICON IS WRITTEN BY finish()
+class BinaryIndexWriter {
+public:
+    bool open(const std::string &path);
+    // TERMS MUST BE ADDED IN STRICTLY INCREASING ORDER
+    bool addTerm(std::string_view term, std::string_view encodedPostings, uint32_t df, uint64_t cf);
+    // docLengths[d] IS THE LENGTH OF DOC d (INDEX 0 UNUSED); THE HIGHEST DOC ID IS
+    // docLengths.size() - 1. FILLS IN THE BM25 MAX SCORES BY RE-READING EACH TERM'S DOC IDS AND TFS,
+    // AND WRITES THE DOC SETS OF THE DENSE TERMS ON THE WAY
+    bool finish(const std::vector<uint32_t> &docLengths);
+
+    void setFlags(uint32_t flags) { flags_ = flags; }
+    // COMPANION INDEXES OF ONE BUILD SHARE A GENERATION; 0 (DEFAULT) STAMPS A NEW ONE
+    void setGeneration(uint64_t generation) { generation_ = generation; }
+
+private:
+    void pad(size_t alignment);
+    bool fillMaxScores(const std::vector<uint32_t> &docLengths, uint64_t totalDocLength);
+    void writeDocSet(LexiconEntry &e, const std::vector<int> &docIds);
+
+    std::fstream out_;
+    std::string path_;
+    std::string termPool_;
+    std::vector<LexiconEntry> lexicon_;
+    std::string lastTerm_;
+    uint64_t offset_ = 0;
+    uint32_t flags_ = 0;
+    uint64_t generation_ = 0;
+};
+
+// A FRESH, PRACTICALLY UNIQUE INDEX GENERATION STAMP
+uint64_t newIndexGeneration();
+
+// WRITE THE MERGED IN-MEMORY INDEX AS A BINARY INDEX FILE (docLengths AS IN finish())
+bool writeBinaryIndex(const std::map<std::string, std::map<int, std::vector<int>>> &index,
+                      const std::vector<uint32_t> &docLengths, const std::string &outFilename,
+                      uint64_t generation = 0, uint32_t flags = 0);
+
+class RoaringBitmap;
+class TermTrigramIndex;
+
+// READ-ONLY VIEW OVER A MEMORY-MAPPED BINARY INDEX; SAFE TO SHARE BETWEEN THREADS
+class IndexReader {
+public:
+    bool open(const std::string &path);
+
+    int termCount() const { return (int)header_.termCount; }
+    int maxDocId() const { return (int)header_.maxDocId; }
+    uint64_t totalDocLength() const { return header_.totalDocLength; }
+    uint64_t generation() const { return header_.generation; }
+    uint32_t flags() const { return header_.flags; }
+    uint32_t docLength(int docId) const {
+        uint32_t length;
+        memcpy(&length, docLengths_ + (size_t)docId * sizeof(uint32_t), sizeof(length));
+        return length;
+    }
+    // RAW POSTINGS OF A TERM (SKIP TABLE FOLLOWED BY BLOCK DATA)
+    const char *termPostings(int termId) const { return file_.data() + lexicon_[termId].postingsOffset; }
+    std::string_view term(int termId) const {
+        const LexiconEntry &e = lexicon_[termId];
+        return std::string_view(termPool_ + e.termOffset, e.termLength);
+    }
+    const LexiconEntry &entry(int termId) const { return lexicon_[termId]; }
+
+    // BINARY SEARCH THE LEXICON; RETURNS -1 IF THE TERM IS ABSENT
+    int findTerm(std::string_view term) const;
+    // ID OF THE FIRST TERM >= term (termCount() IF THERE IS NONE)
+    int lowerBound(std::string_view term) const;
+    // [first, second) TERM IDS OF THE TERMS STARTING WITH prefix, A CONTIGUOUS RANGE OF THE SORTED LEXICON
+    std::pair<int, int> prefixRange(std::string_view prefix) const;
+    // TRIGRAM INDEX OVER THE LEXICON FOR WILDCARD TERMS (wildcard.h), BUILT ON FIRST USE
+    const TermTrigramIndex &termTrigrams() const;
+
+    // START READING A TERM'S POSTINGS IN THE BACKGROUND / TRUE IF THEY ARE ALREADY IN MEMORY. BOTH
+    // INCLUDE A DENSE TERM'S DOC SET: WHETHER A QUERY READS THAT OR THE POSTINGS IS ONLY DECIDED BY ITS PLAN
+    void prefetchPostings(int termId) const {
+        const LexiconEntry &e = lexicon_[termId];
+        file_.prefetch(e.postingsOffset, e.postingsBytes);
+        if (e.docSetBytes > 0) file_.prefetch(e.docSetOffset, e.docSetBytes);
+    }
+    bool postingsResident(int termId) const {
+        const LexiconEntry &e = lexicon_[termId];
+        return file_.resident(e.postingsOffset, e.postingsBytes) &&
+               (e.docSetBytes == 0 || file_.resident(e.docSetOffset, e.docSetBytes));
+    }
+
+    // DECODE A TERM'S POSTINGS; POSITIONS ARE LEFT EMPTY WHEN withPositions IS FALSE
+    void decodePostings(int termId, PostingList &out, bool withPositions = true) const;
+    // ONLY THE DOCS IN [firstDoc, lastDoc]: THE SKIP TABLE FINDS THE FIRST BLOCK, DECODING STOPS PAST lastDoc
+    void decodePostingsRange(int termId, int firstDoc, int lastDoc, PostingList &out,
+                             bool withPositions = true) const;
+    // LAST DOC ID OF ONE OF A TERM'S POSTING BLOCKS
+    int blockLastDoc(int termId, size_t block) const {
+        SkipEntry skip;
+        memcpy(&skip, termPostings(termId) + block * sizeof(SkipEntry), sizeof(skip));
+        return skip.lastDocId;
+    }
+    bool hasDocSet(int termId) const { return lexicon_[termId].docSetBytes > 0; }
+    // LOAD A DENSE TERM'S DOC SET; FALSE IF THE TERM HAS NONE
+    bool loadDocSet(int termId, RoaringBitmap &out) const;
+
+private:
+    MappedFile file_;
+    BinaryIndexHeader header_{};
+    const LexiconEntry *lexicon_ = nullptr;
+    const char *termPool_ = nullptr;
+    const char *docLengths_ = nullptr;
+    mutable std::once_flag trigramsOnce_;
+    mutable std::shared_ptr<const TermTrigramIndex> trigrams_;
+};
+
+// OPEN THE BIWORD INDEX BUILT TOGETHER WITH main. RETURNS FALSE (QUIETLY IF THE FILE DOES NOT EXIST)
+// WHEN THERE IS NO USABLE BIWORD INDEX FOR THIS BUILD
+bool openBiwordIndex(const std::string &path, const IndexReader &main, IndexReader &biwords);
+
+// LAZY CURSOR OVER ONE TERM'S ON-DISK POSTINGS: DECODES DOC IDS AND TFS (NEVER POSITIONS) ONE
+// BLOCK AT A TIME AND SKIPS WHOLE BLOCKS THROUGH THE SKIP TABLE WITHOUT DECODING THEM
+class BlockCursor {
+public:
+    BlockCursor(const IndexReader &index, int termId);
+
+    int doc() const { return pos_ < count_ ? docs_[pos_] : END_DOC; }
+    uint32_t tf() const { return tfs_[pos_]; }
+    void next();
+    // MOVE TO THE FIRST DOC >= target
+    void advance(int target);
+
+    // MOVE ONLY THE SHALLOW BLOCK POINTER TO THE BLOCK THAT WOULD CONTAIN target (NOTHING IS DECODED)
+    void shallowAdvance(int target);
+    int shallowLastDoc() const;     // LAST DOC OF THE SHALLOW BLOCK, END_DOC PAST THE END
+    float shallowMaxScore() const;  // BLOCK-MAX SCORE OF THE SHALLOW BLOCK, 0 PAST THE END
+
+    float maxScore() const { return maxScore_; }
+    uint32_t df() const { return df_; }
+    size_t blockCount() const { return blockCount_; }
+    size_t blocksDecoded() const { return blocksDecoded_; }
+
+private:
+    SkipEntry skip(size_t block) const {
+        SkipEntry entry;
+        memcpy(&entry, base_ + block * sizeof(SkipEntry), sizeof(entry));
+        return entry;
+    }
+    // FIRST BLOCK >= from WHOSE LAST DOC IS >= target (GALLOPING OVER THE SKIP TABLE)
+    size_t findBlock(size_t from, int target) const;
+    void loadBlock(size_t block);
+
+    const char *base_;
+    const char *data_;
+    uint32_t df_;
+    float maxScore_;
+    size_t blockCount_;
+    size_t block_ = 0;
+    size_t shallow_ = 0;
+    size_t count_ = 0;
+    size_t pos_ = 0;
+    size_t blocksDecoded_ = 0;
+    int docs_[POSTING_BLOCK_SIZE];
+    uint32_t tfs_[POSTING_BLOCK_SIZE];
+};
+
+#endif
@@ -0,0 +1,114 @@
+#include "doc_offsets.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+bool DocOffsetsWriter::open(const string &path) {
+    path_ = path;
+    out_.open(path, ios::binary | ios::trunc);
+    if (!out_.is_open()) {
+        cerr << "ERROR OPENING OFFSETS FILE FOR WRITING: " << path << endl;
+        return false;
+    }
+    // HEADER IS WRITTEN AGAIN BY finish()
+    DocOffsetsHeader header{};
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    offset_ = sizeof(header);
+    offsets_.assign(1, offset_);  // DOC 0 IS NEVER USED
+    return true;
+}
+
+bool DocOffsetsWriter::addDoc(int docId, const vector<TokenSpan> &spans) {
+    if (docId < (int)offsets_.size()) {
+        cerr << "ERROR: OFFSETS ADDED OUT OF DOC ORDER: " << docId << endl;
+        return false;
+    }
+    offsets_.resize((size_t)docId + 1, offset_);
+
+    record_.clear();
+    appendVarint(record_, (uint32_t)spans.size());
+    uint32_t prevEnd = 0;
+    for (const TokenSpan &span : spans) {
+        appendVarint(record_, span.start - prevEnd);
+        appendVarint(record_, span.end - span.start);
+        prevEnd = span.end;
+    }
+    out_.write(record_.data(), (streamsize)record_.size());
+    offset_ += record_.size();
+    return true;
+}
+
+bool DocOffsetsWriter::finish(uint64_t generation) {
+    DocOffsetsHeader header{};
+    memcpy(header.magic, DOC_OFFSETS_MAGIC, sizeof(header.magic));
+    header.version = DOC_OFFSETS_VERSION;
+    header.maxDocId = offsets_.size() - 1;
+    header.generation = generation;
+    header.offsetsOffset = offset_;
+
+    offsets_.push_back(offset_);  // END OF THE LAST RECORD
+    out_.write(reinterpret_cast<const char *>(offsets_.data()), (streamsize)(offsets_.size() * sizeof(uint64_t)));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        cerr << "ERROR WRITING OFFSETS FILE: " << path_ << endl;
+        return false;
+    }
+    cout << "BYTE OFFSETS WRITTEN TO: " << path_ << "\n";
+    return true;
+}
+
+bool DocOffsets::open(const string &path) {
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(DocOffsetsHeader)) {
+        cerr << "ERROR: FILE TOO SMALL TO BE AN OFFSETS FILE: " << path << endl;
+        return false;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, DOC_OFFSETS_MAGIC, sizeof(header_.magic)) != 0 ||
+        header_.version != DOC_OFFSETS_VERSION) {
+        cerr << "ERROR: NOT A SUPPORTED OFFSETS FILE: " << path << endl;
+        return false;
+    }
+    if (header_.offsetsOffset + (header_.maxDocId + 2) * sizeof(uint64_t) > file_.size()) {
+        cerr << "ERROR: TRUNCATED OFFSETS FILE: " << path << endl;
+        return false;
+    }
+    offsets_ = file_.data() + header_.offsetsOffset;
+    return true;
+}
+
+void DocOffsets::spans(int docId, vector<TokenSpan> &out) const {
+    out.clear();
+    if (docId < 1 || (uint64_t)docId > header_.maxDocId) return;
+    uint64_t begin, end;
+    memcpy(&begin, offsets_ + (size_t)docId * sizeof(uint64_t), sizeof(begin));
+    memcpy(&end, offsets_ + ((size_t)docId + 1) * sizeof(uint64_t), sizeof(end));
+    if (begin == end) return;
+
+    const char *p = file_.data() + begin;
+    uint32_t count, gap, length, prevEnd = 0;
+    p = readVarint(p, count);
+    out.reserve(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        p = readVarint(p, gap);
+        p = readVarint(p, length);
+        TokenSpan span{prevEnd + gap, prevEnd + gap + length};
+        out.push_back(span);
+        prevEnd = span.end;
+    }
+}
+
+bool openDocOffsets(const string &path, const IndexReader &main, DocOffsets &offsets) {
+    ifstream probe(path);
+    if (!probe.is_open()) return false;
+    probe.close();
+    if (!offsets.open(path)) return false;
+    if (offsets.generation() != main.generation()) {
+        cerr << "WARNING: OFFSETS FILE IS FROM ANOTHER BUILD, IGNORING: " << path << endl;
+        return false;
+    }
+    return true;
+}
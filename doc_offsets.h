@@ -0,0 +1,71 @@
+#ifndef _DOC_OFFSETS_H_
+#define _DOC_OFFSETS_H_
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "binary_index.h"
+#include "mapped_file.h"
+#include "tokenizer.h"
+
+// OPTIONAL BYTE-OFFSET STREAM (pos_offsets.bin), WRITTEN WITH ./main --offsets
+//
+// POSITIONS ARE WORD ORDINALS; THIS FILE MAPS EVERY POSITION OF EVERY DOC BACK TO THE BYTES OF THE
+// WORD IN THE ORIGINAL FILE, SO ANY POSTING OCCURRENCE (doc, position) CAN BE SHOWN OR HIGHLIGHTED
+// BY SEEKING STRAIGHT INTO THE DOCUMENT INSTEAD OF RE-READING AND RE-TOKENIZING IT.
+//
+// LAYOUT (ALL INTEGERS LITTLE-ENDIAN):
+//   HEADER   DocOffsetsHeader
+//   RECORDS  PER DOC: VARINT WORD COUNT, THEN PER WORD VARINT (start - PREVIOUS end), VARINT (end - start)
+//   OFFSETS  uint64_t[maxDocId + 2]: RECORD OF DOC d SPANS [offsets[d], offsets[d + 1]) (EMPTY IF MISSING)
+//
+// RECORDS ARE STREAMED OUT DOC BY DOC WHILE INDEXING, SO NOTHING IS KEPT IN MEMORY BUT THE OFFSETS
+
+static const char DOC_OFFSETS_MAGIC[8] = {'S', 'P', 'I', 'M', 'I', 'O', 'F', 'S'};
+static const uint32_t DOC_OFFSETS_VERSION = 1;
+
+struct DocOffsetsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t maxDocId;
+    uint64_t generation;     // SAME AS THE pos_inverted_index.bin IT WAS BUILT WITH
+    uint64_t offsetsOffset;
+};
+
+class DocOffsetsWriter {
+public:
+    bool open(const std::string &path);
+    // DOCS MUST BE ADDED IN INCREASING ID ORDER; IDS NEVER ADDED HAVE NO SPANS
+    bool addDoc(int docId, const std::vector<TokenSpan> &spans);
+    bool finish(uint64_t generation);
+
+private:
+    std::ofstream out_;
+    std::string path_;
+    std::string record_;
+    std::vector<uint64_t> offsets_;  // offsets_[d] = START OF DOC d'S RECORD
+    uint64_t offset_ = 0;
+};
+
+// READ-ONLY VIEW OVER A MEMORY-MAPPED OFFSET STREAM; SAFE TO SHARE BETWEEN THREADS
+class DocOffsets {
+public:
+    bool open(const std::string &path);
+    uint64_t generation() const { return header_.generation; }
+    int maxDocId() const { return (int)header_.maxDocId; }
+    // SPANS OF EVERY POSITION OF THE DOC (EMPTY FOR AN UNKNOWN DOC)
+    void spans(int docId, std::vector<TokenSpan> &out) const;
+
+private:
+    MappedFile file_;
+    DocOffsetsHeader header_{};
+    const char *offsets_ = nullptr;
+};
+
+// OPEN THE OFFSET STREAM BUILT TOGETHER WITH main. RETURNS FALSE (QUIETLY IF THE FILE DOES NOT
+// EXIST) WHEN THERE IS NO USABLE STREAM FOR THIS BUILD
+bool openDocOffsets(const std::string &path, const IndexReader &main, DocOffsets &offsets);
+
+#endif
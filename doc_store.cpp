@@ -0,0 +1,167 @@
+#include "doc_store.h"
+#include "lz_codec.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+bool DocStoreWriter::open(const string &path) {
+    path_ = path;
+    out_.open(path, ios::binary | ios::trunc);
+    if (!out_.is_open()) {
+        cerr << "ERROR OPENING DOC STORE FOR WRITING: " << path << endl;
+        return false;
+    }
+    // HEADER IS WRITTEN AGAIN BY finish()
+    DocStoreHeader header{};
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    offset_ = sizeof(header);
+    docs_.assign(1, DocStoreEntry{});  // DOC 0 IS NEVER USED
+    return true;
+}
+
+bool DocStoreWriter::addDoc(int docId, const string &text) {
+    if (docId < (int)docs_.size()) {
+        cerr << "ERROR: DOC STORE DOCS ADDED OUT OF ORDER: " << docId << endl;
+        return false;
+    }
+    if (text.size() > UINT32_MAX) {
+        cerr << "ERROR: DOCUMENT TOO LARGE FOR THE DOC STORE: " << docId << endl;
+        return false;
+    }
+    // A DOC NEVER SPANS TWO BLOCKS
+    if (!block_.empty() && block_.size() + text.size() > DOC_STORE_BLOCK_BYTES) flushBlock();
+    docs_.resize((size_t)docId + 1, DocStoreEntry{});
+    docs_[docId] = DocStoreEntry{(uint32_t)blocks_.size(), (uint32_t)block_.size(), (uint32_t)text.size()};
+    block_.append(text);
+    rawTotal_ += text.size();
+    if (block_.size() >= DOC_STORE_BLOCK_BYTES) flushBlock();
+    return true;
+}
+
+void DocStoreWriter::flushBlock() {
+    compressed_.clear();
+    lzCompress(block_.data(), block_.size(), compressed_);
+    const string &stored = compressed_.size() < block_.size() ? compressed_ : block_;
+    blocks_.push_back(DocStoreBlock{offset_, (uint32_t)stored.size(), (uint32_t)block_.size()});
+    out_.write(stored.data(), (streamsize)stored.size());
+    offset_ += stored.size();
+    block_.clear();
+}
+
+bool DocStoreWriter::finish(uint64_t generation) {
+    if (!block_.empty()) flushBlock();
+
+    DocStoreHeader header{};
+    memcpy(header.magic, DOC_STORE_MAGIC, sizeof(header.magic));
+    header.version = DOC_STORE_VERSION;
+    header.blockBytes = (uint32_t)DOC_STORE_BLOCK_BYTES;
+    header.maxDocId = docs_.size() - 1;
+    header.blockCount = blocks_.size();
+    header.generation = generation;
+    header.blockTableOffset = offset_;
+    header.docTableOffset = offset_ + blocks_.size() * sizeof(DocStoreBlock);
+
+    out_.write(reinterpret_cast<const char *>(blocks_.data()), (streamsize)(blocks_.size() * sizeof(DocStoreBlock)));
+    out_.write(reinterpret_cast<const char *>(docs_.data()), (streamsize)(docs_.size() * sizeof(DocStoreEntry)));
+    out_.seekp(0);
+    out_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out_.close();
+    if (!out_) {
+        cerr << "ERROR WRITING DOC STORE: " << path_ << endl;
+        return false;
+    }
+    uint64_t storedTotal = header.docTableOffset + docs_.size() * sizeof(DocStoreEntry);
+    cout << "DOC STORE WRITTEN TO: " << path_ << " (" << rawTotal_ / 1024 << " KB OF TEXT IN "
+         << storedTotal / 1024 << " KB)\n";
+    return true;
+}
+
+bool DocStore::open(const string &path) {
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(DocStoreHeader)) {
+        cerr << "ERROR: FILE TOO SMALL TO BE A DOC STORE: " << path << endl;
+        return false;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, DOC_STORE_MAGIC, sizeof(header_.magic)) != 0 || header_.version != DOC_STORE_VERSION) {
+        cerr << "ERROR: NOT A SUPPORTED DOC STORE FILE: " << path << endl;
+        return false;
+    }
+    if (header_.docTableOffset + (header_.maxDocId + 1) * sizeof(DocStoreEntry) > file_.size()) {
+        cerr << "ERROR: TRUNCATED DOC STORE: " << path << endl;
+        return false;
+    }
+    blockTable_ = file_.data() + header_.blockTableOffset;
+    docTable_ = file_.data() + header_.docTableOffset;
+    return true;
+}
+
+DocStoreEntry DocStore::entry(int docId) const {
+    DocStoreEntry e{};
+    if (docId >= 1 && (uint64_t)docId <= header_.maxDocId) {
+        memcpy(&e, docTable_ + (size_t)docId * sizeof(DocStoreEntry), sizeof(e));
+    }
+    return e;
+}
+
+// CALLERS HOLD mutex_
+shared_ptr<const string> DocStore::cached(uint32_t index) const {
+    for (size_t i = 0; i < cache_.size(); ++i) {
+        if (cache_[i].first != index) continue;
+        rotate(cache_.begin(), cache_.begin() + i, cache_.begin() + i + 1);
+        return cache_[0].second;
+    }
+    return nullptr;
+}
+
+shared_ptr<const string> DocStore::block(uint32_t index) const {
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (auto text = cached(index)) return text;
+    }
+
+    // DECOMPRESS OUTSIDE THE LOCK; TWO THREADS MISSING THE SAME BLOCK BOTH DECODE IT, BUT ONLY ONE COPY
+    // IS CACHED
+    if (index >= header_.blockCount) return nullptr;
+    DocStoreBlock b;
+    memcpy(&b, blockTable_ + (size_t)index * sizeof(DocStoreBlock), sizeof(b));
+    if (b.offset + b.storedBytes > header_.blockTableOffset) return nullptr;
+    auto text = make_shared<string>(b.rawBytes, '\0');
+    if (b.storedBytes == b.rawBytes) {
+        memcpy(&(*text)[0], file_.data() + b.offset, b.rawBytes);
+    } else if (!lzDecompress(file_.data() + b.offset, b.storedBytes, &(*text)[0], b.rawBytes)) {
+        cerr << "ERROR: CORRUPT DOC STORE BLOCK " << index << endl;
+        return nullptr;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    if (auto other = cached(index)) return other;
+    cache_.insert(cache_.begin(), make_pair(index, shared_ptr<const string>(text)));
+    if (cache_.size() > cacheBlocks_) cache_.pop_back();
+    return text;
+}
+
+bool DocStore::read(int docId, size_t begin, size_t length, string &out) const {
+    out.clear();
+    DocStoreEntry e = entry(docId);
+    if (e.length == 0) return false;
+    shared_ptr<const string> text = block(e.block);
+    if (!text || (size_t)e.offset + e.length > text->size()) return false;
+    if (begin < e.length) out.assign(*text, e.offset + begin, min(length, e.length - begin));
+    return true;
+}
+
+bool openDocStore(const string &path, const IndexReader &main, DocStore &store) {
+    ifstream probe(path);
+    if (!probe.is_open()) return false;
+    probe.close();
+    if (!store.open(path)) return false;
+    if (store.generation() != main.generation()) {
+        cerr << "WARNING: DOC STORE IS FROM ANOTHER BUILD, IGNORING: " << path << endl;
+        return false;
+    }
+    return true;
+}
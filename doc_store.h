@@ -0,0 +1,108 @@
+#ifndef _DOC_STORE_H_
+#define _DOC_STORE_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "binary_index.h"
+#include "mapped_file.h"
+
+// BLOCK-COMPRESSED DOCUMENT STORE (pos_doc_store.bin), WRITTEN WITH ./main --doc-store
+//
+// THE TEXT OF EVERY DOC IS KEPT SO RESULTS CAN BE RENDERED WITHOUT THE ORIGINAL FILES. DOCS ARE
+// PACKED INTO BLOCKS OF ABOUT DOC_STORE_BLOCK_BYTES (A LARGER DOC GETS A BLOCK OF ITS OWN) AND EACH
+// BLOCK IS COMPRESSED WITH lz_codec.h, SO A LOOKUP DECOMPRESSES ONE BLOCK.
+//
+// LAYOUT (ALL INTEGERS LITTLE-ENDIAN):
+//   HEADER   DocStoreHeader
+//   BLOCKS   COMPRESSED BLOCK DATA (STORED RAW WHEN COMPRESSION DOES NOT HELP)
+//   BLOCK TABLE  DocStoreBlock[blockCount]
+//   DOC TABLE    DocStoreEntry[maxDocId + 1] INDEXED BY DOC ID (LENGTH 0 FOR A MISSING DOC)
+
+static const char DOC_STORE_MAGIC[8] = {'S', 'P', 'I', 'M', 'I', 'D', 'S', 'T'};
+static const uint32_t DOC_STORE_VERSION = 1;
+static const size_t DOC_STORE_BLOCK_BYTES = 32 << 10;
+// DECOMPRESSED BLOCKS KEPT BY A DocStore
+static const size_t DOC_STORE_CACHE_BLOCKS = 64;
+
+struct DocStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t blockBytes;
+    uint64_t maxDocId;
+    uint64_t blockCount;
+    uint64_t generation;        // SAME AS THE pos_inverted_index.bin IT WAS BUILT WITH
+    uint64_t blockTableOffset;
+    uint64_t docTableOffset;
+};
+
+struct DocStoreBlock {
+    uint64_t offset;            // ABSOLUTE FILE OFFSET OF THE BLOCK DATA
+    uint32_t storedBytes;
+    uint32_t rawBytes;          // storedBytes == rawBytes: STORED UNCOMPRESSED
+};
+
+struct DocStoreEntry {
+    uint32_t block;
+    uint32_t offset;            // INSIDE THE DECOMPRESSED BLOCK
+    uint32_t length;
+};
+
+class DocStoreWriter {
+public:
+    bool open(const std::string &path);
+    // DOCS MUST BE ADDED IN INCREASING ID ORDER
+    bool addDoc(int docId, const std::string &text);
+    bool finish(uint64_t generation);
+
+private:
+    void flushBlock();
+
+    std::ofstream out_;
+    std::string path_;
+    std::string block_;
+    std::string compressed_;
+    std::vector<DocStoreBlock> blocks_;
+    std::vector<DocStoreEntry> docs_;
+    uint64_t offset_ = 0;
+    uint64_t rawTotal_ = 0;
+};
+
+// READ-ONLY VIEW OVER A MEMORY-MAPPED DOC STORE WITH A SMALL LRU CACHE OF DECOMPRESSED BLOCKS;
+// SAFE TO SHARE BETWEEN THREADS
+class DocStore {
+public:
+    explicit DocStore(size_t cacheBlocks = DOC_STORE_CACHE_BLOCKS) : cacheBlocks_(cacheBlocks) {}
+
+    bool open(const std::string &path);
+    uint64_t generation() const { return header_.generation; }
+    int maxDocId() const { return (int)header_.maxDocId; }
+
+    // length BYTES FROM begin (CLIPPED TO THE DOC). FALSE FOR AN UNKNOWN DOC OR A CORRUPT BLOCK
+    bool read(int docId, size_t begin, size_t length, std::string &out) const;
+
+private:
+    DocStoreEntry entry(int docId) const;
+    std::shared_ptr<const std::string> block(uint32_t index) const;
+    std::shared_ptr<const std::string> cached(uint32_t index) const;
+
+    MappedFile file_;
+    DocStoreHeader header_{};
+    const char *blockTable_ = nullptr;
+    const char *docTable_ = nullptr;
+
+    // MOST RECENTLY USED FIRST; A LINEAR SCAN IS CHEAP AT THIS SIZE
+    size_t cacheBlocks_;
+    mutable std::mutex mutex_;
+    mutable std::vector<std::pair<uint32_t, std::shared_ptr<const std::string>>> cache_;
+};
+
+// OPEN THE DOC STORE BUILT TOGETHER WITH main. RETURNS FALSE (QUIETLY IF THE FILE DOES NOT EXIST)
+// WHEN THERE IS NO USABLE STORE FOR THIS BUILD
+bool openDocStore(const std::string &path, const IndexReader &main, DocStore &store);
+
+#endif
@@ -0,0 +1,136 @@
+#include "doc_table.h"
+#include "binary_index.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+bool writeDocTable(const map<int, string> &docIdToPath, const string &outFilename) {
+    ofstream out(outFilename, ios::binary | ios::trunc);
+    if (!out.is_open()) {
+        cerr << "ERROR OPENING DOC TABLE FOR WRITING: " << outFilename << endl;
+        return false;
+    }
+
+    uint64_t docCount = docIdToPath.empty() ? 0 : (uint64_t)max(0, docIdToPath.rbegin()->first);
+    vector<uint64_t> offsets;
+    offsets.reserve(docCount + 1);
+    offsets.push_back(0);
+    string pool;
+    string restartPath;
+
+    for (uint64_t idx = 0; idx < docCount; ++idx) {
+        auto it = docIdToPath.find((int)idx + 1);
+        const string &path = it != docIdToPath.end() ? it->second : string();
+        if (idx % DOC_TABLE_RESTART_INTERVAL == 0) {
+            restartPath = path;
+            appendVarint(pool, 0);
+            pool.append(path);
+        } else if (!path.empty()) {
+            size_t shared = 0;
+            size_t limit = min(path.size(), restartPath.size());
+            while (shared < limit && path[shared] == restartPath[shared]) ++shared;
+            appendVarint(pool, (uint32_t)shared);
+            pool.append(path, shared, string::npos);
+        }
+        offsets.push_back(pool.size());
+    }
+
+    DocTableHeader header{};
+    memcpy(header.magic, DOC_TABLE_MAGIC, sizeof(header.magic));
+    header.version = DOC_TABLE_VERSION;
+    header.restartInterval = DOC_TABLE_RESTART_INTERVAL;
+    header.docCount = docCount;
+    header.offsetsOffset = sizeof(header);
+    header.poolOffset = header.offsetsOffset + offsets.size() * sizeof(uint64_t);
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char *>(offsets.data()), (streamsize)(offsets.size() * sizeof(uint64_t)));
+    out.write(pool.data(), (streamsize)pool.size());
+    out.close();
+    if (!out) {
+        cerr << "ERROR WRITING DOC TABLE: " << outFilename << endl;
+        return false;
+    }
+    cout << "DOC TABLE WRITTEN TO: " << outFilename << "\n";
+    return true;
+}
+
+bool importDocTableCsv(const string &csvFilename, const string &outFilename) {
+    ifstream in(csvFilename);
+    if (!in.is_open()) {
+        cerr << "ERROR OPENING DOC MAPPING CSV: " << csvFilename << endl;
+        return false;
+    }
+    map<int, string> docIdToPath;
+    string line;
+    getline(in, line); // HEADER: docID,relative_path
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        size_t comma = line.find(',');
+        if (comma == string::npos) continue;
+        int docId = atoi(line.substr(0, comma).c_str());
+        if (docId > 0) docIdToPath[docId] = line.substr(comma + 1);
+    }
+    return writeDocTable(docIdToPath, outFilename);
+}
+
+bool DocTable::open(const string &path) {
+    if (!file_.open(path)) return false;
+    if (file_.size() < sizeof(DocTableHeader)) {
+        cerr << "ERROR: FILE TOO SMALL TO BE A DOC TABLE: " << path << endl;
+        return false;
+    }
+    memcpy(&header_, file_.data(), sizeof(header_));
+    if (memcmp(header_.magic, DOC_TABLE_MAGIC, sizeof(header_.magic)) != 0 || header_.version != DOC_TABLE_VERSION) {
+        cerr << "ERROR: NOT A SUPPORTED DOC TABLE FILE: " << path << endl;
+        return false;
+    }
+    // RECORD OFFSETS ARE CHECKED AGAINST THE POOL ON EVERY LOOKUP
+    if (header_.restartInterval == 0 || header_.poolOffset > file_.size() ||
+        header_.offsetsOffset > header_.poolOffset ||
+        header_.docCount >= (header_.poolOffset - header_.offsetsOffset) / sizeof(uint64_t)) {
+        cerr << "ERROR: TRUNCATED DOC TABLE: " << path << endl;
+        return false;
+    }
+    offsets_ = file_.data() + header_.offsetsOffset;
+    pool_ = file_.data() + header_.poolOffset;
+    poolSize_ = file_.size() - header_.poolOffset;
+    return true;
+}
+
+string DocTable::path(int docId) const {
+    if (docId < 1 || (uint64_t)docId > header_.docCount) return string();
+    auto record = [&](uint64_t idx, uint32_t &shared) {
+        uint64_t begin, end;
+        memcpy(&begin, offsets_ + idx * sizeof(uint64_t), sizeof(uint64_t));
+        memcpy(&end, offsets_ + (idx + 1) * sizeof(uint64_t), sizeof(uint64_t));
+        shared = 0;
+        if (begin >= end || end > poolSize_) return string_view();
+        // BOUNDED VARINT: A DAMAGED RECORD MUST NOT READ PAST ITS END
+        const char *p = pool_ + begin;
+        for (int shift = 0; p < pool_ + end && shift < 32; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(*p++);
+            shared |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return string_view(p, (size_t)(pool_ + end - p));
+        }
+        shared = 0;
+        return string_view();
+    };
+
+    uint64_t idx = (uint64_t)docId - 1;
+    uint32_t shared;
+    string_view suffix = record(idx, shared);
+    if (suffix.empty() && shared == 0) return string();
+
+    string result;
+    if (shared > 0) {
+        uint32_t unused;
+        string_view restart = record(idx - idx % header_.restartInterval, unused);
+        result.assign(restart.substr(0, shared));
+    }
+    result.append(suffix);
+    return result;
+}
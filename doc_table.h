@@ -0,0 +1,54 @@
+#ifndef _DOC_TABLE_H_
+#define _DOC_TABLE_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include "mapped_file.h"
+
+// BINARY DOC-ID -> PATH TABLE (docId_filePath_mapping.bin)
+//
+// LAYOUT (ALL INTEGERS LITTLE-ENDIAN):
+//   HEADER   DocTableHeader
+//   OFFSETS  uint64_t[docCount + 1]: RECORD OF DOC d SPANS pool[offsets[d - 1] .. offsets[d])
+//   POOL     RECORDS: VARINT SHARED-PREFIX LENGTH + SUFFIX BYTES
+//
+// PATHS ARE PREFIX-COMPRESSED AGAINST THE FIRST DOC OF THEIR GROUP OF DOC_TABLE_RESTART_INTERVAL,
+// WHICH IS STORED IN FULL, SO ANY LOOKUP DECODES AT MOST TWO RECORDS. A MISSING DOC ID HAS AN
+// EMPTY RECORD.
+
+static const char DOC_TABLE_MAGIC[8] = {'S', 'P', 'I', 'M', 'I', 'D', 'O', 'C'};
+static const uint32_t DOC_TABLE_VERSION = 1;
+static const uint32_t DOC_TABLE_RESTART_INTERVAL = 16;
+
+struct DocTableHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t restartInterval;
+    uint64_t docCount;  // HIGHEST DOC ID; IDS ARE 1-BASED
+    uint64_t offsetsOffset;
+    uint64_t poolOffset;
+};
+
+bool writeDocTable(const std::map<int, std::string> &docIdToPath, const std::string &outFilename);
+
+// CONVERT A docId_filePath_mapping.csv FILE INTO A DOC TABLE
+bool importDocTableCsv(const std::string &csvFilename, const std::string &outFilename);
+
+// READ-ONLY VIEW OVER A MEMORY-MAPPED DOC TABLE
+class DocTable {
+public:
+    bool open(const std::string &path);
+    int docCount() const { return (int)header_.docCount; }
+    // RETURNS AN EMPTY STRING FOR UNKNOWN DOC IDS
+    std::string path(int docId) const;
+
+private:
+    MappedFile file_;
+    DocTableHeader header_{};
+    const char *offsets_ = nullptr;
+    const char *pool_ = nullptr;
+    uint64_t poolSize_ = 0;
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "frequency_sketch.h"
+#include <algorithm>
+
+using namespace std;
+
+// INDEPENDENT ODD MULTIPLIERS, ONE PER ROW
+static const uint64_t ROW_SEEDS[4] = {0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL,
+                                      0xD6E8FEB86659FD93ULL};
+
+FrequencySketch::FrequencySketch(size_t width) {
+    size_t size = 64;
+    while (size < width) size <<= 1;
+    mask_ = size - 1;
+    counters_.assign(ROWS * size, 0);
+    sampleSize_ = 10 * size;
+}
+
+uint64_t FrequencySketch::hashKey(string_view key) {
+    // FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (char c : key) {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+size_t FrequencySketch::slot(uint64_t hash, int row) const {
+    uint64_t mixed = (hash + (uint64_t)row) * ROW_SEEDS[row];
+    return (size_t)row * (mask_ + 1) + (size_t)((mixed >> 32) & mask_);
+}
+
+void FrequencySketch::increment(uint64_t hash) {
+    // CONSERVATIVE UPDATE: ONLY THE SMALLEST COUNTERS GROW
+    uint32_t current = estimate(hash);
+    if (current < MAX_COUNT) {
+        for (int row = 0; row < ROWS; ++row) {
+            uint8_t &counter = counters_[slot(hash, row)];
+            if (counter == current) ++counter;
+        }
+    }
+    if (++additions_ >= sampleSize_) age();
+}
+
+uint32_t FrequencySketch::estimate(uint64_t hash) const {
+    uint32_t minimum = MAX_COUNT;
+    for (int row = 0; row < ROWS; ++row) minimum = min<uint32_t>(minimum, counters_[slot(hash, row)]);
+    return minimum;
+}
+
+void FrequencySketch::age() {
+    for (uint8_t &counter : counters_) counter >>= 1;
+    additions_ /= 2;
+}
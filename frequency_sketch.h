@@ -0,0 +1,35 @@
+#ifndef _FREQUENCY_SKETCH_H_
+#define _FREQUENCY_SKETCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+// TINYLFU POPULARITY ESTIMATE: A COUNT-MIN SKETCH OF SATURATING 4-BIT COUNTERS THAT IS AGED
+// (EVERY COUNTER HALVED) AFTER A FIXED NUMBER OF INCREMENTS, SO OLD POPULARITY FADES OUT.
+// NOT THREAD-SAFE; OWNERS LOCK AROUND IT
+class FrequencySketch {
+public:
+    // width: COUNTERS PER ROW, ROUNDED UP TO A POWER OF TWO; ABOUT ONE PER TRACKED ITEM
+    explicit FrequencySketch(size_t width);
+
+    void increment(uint64_t hash);
+    uint32_t estimate(uint64_t hash) const;
+
+    static uint64_t hashKey(std::string_view key);
+
+private:
+    static const int ROWS = 4;
+    static const uint8_t MAX_COUNT = 15;
+
+    size_t slot(uint64_t hash, int row) const;
+    void age();
+
+    std::vector<uint8_t> counters_;  // ROWS * (mask_ + 1)
+    size_t mask_;
+    size_t additions_ = 0;
+    size_t sampleSize_;
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "fuzzy.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+// DEPTH-FIRST WALK OF THE LEXICON TRIE. rows[d] IS THE AUTOMATON STATE AFTER THE FIRST d LETTERS OF
+// THE CURRENT PREFIX: rows[d][j] = EDIT DISTANCE BETWEEN THAT PREFIX AND query[0 .. j)
+class FuzzyWalk {
+public:
+    FuzzyWalk(const IndexReader &index, string_view query, int maxEdits, TermExpansion &out)
+        : index_(index), query_(query), maxEdits_(maxEdits), out_(out) {
+        rows_.emplace_back(query_.size() + 1);
+        for (size_t j = 0; j <= query_.size(); ++j) rows_[0][j] = (int)j;
+    }
+
+    void run() { walk(0, index_.termCount(), 0); }
+
+private:
+    // TERMS [lo, hi) ALL START WITH THE SAME depth-LETTER PREFIX, WHOSE STATE IS rows_[depth]
+    void walk(int lo, int hi, size_t depth) {
+        // THE PREFIX ITSELF SORTS FIRST
+        string_view first = index_.term(lo);
+        if (first.size() == depth) {
+            if (rows_[depth][query_.size()] <= maxEdits_ &&
+                first.find(COMMON_GRAM_SEPARATOR) == string_view::npos) {
+                out_.termIds.push_back(lo);
+            }
+            ++lo;
+        }
+        while (lo < hi) {
+            string_view term = index_.term(lo);
+            unsigned char c = (unsigned char)term[depth];
+            int end = groupEnd(lo, hi, depth, c);
+            if (step(depth, term)) walk(lo, end, depth + 1);
+            lo = end;
+        }
+    }
+
+    // FIRST TERM IN [lo, hi) WHOSE LETTER AT depth IS PAST c (THE LETTERS THERE ARE SORTED)
+    int groupEnd(int lo, int hi, size_t depth, unsigned char c) const {
+        ++lo;
+        while (lo < hi) {
+            int mid = lo + (hi - lo) / 2;
+            if ((unsigned char)index_.term(mid)[depth] <= c) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo;
+    }
+
+    // FILL rows_[depth + 1] FOR THE PREFIX term[0 .. depth]; FALSE IF NO EXTENSION OF IT CAN MATCH
+    bool step(size_t depth, string_view term) {
+        if (rows_.size() <= depth + 1) rows_.emplace_back(query_.size() + 1);
+        const vector<int> &prev = rows_[depth];
+        vector<int> &row = rows_[depth + 1];
+        char c = term[depth];
+        row[0] = (int)depth + 1;
+        int best = row[0];
+        for (size_t j = 1; j <= query_.size(); ++j) {
+            int cost = min({prev[j] + 1, row[j - 1] + 1, prev[j - 1] + (query_[j - 1] == c ? 0 : 1)});
+            // ADJACENT TRANSPOSITION
+            if (depth >= 1 && j >= 2 && query_[j - 1] == term[depth - 1] && query_[j - 2] == c) {
+                cost = min(cost, rows_[depth - 1][j - 2] + 1);
+            }
+            row[j] = cost;
+            best = min(best, cost);
+        }
+        // A LATER ROW ONLY DERIVES FROM THIS ONE (NEVER CHEAPER) OR, BY A TRANSPOSITION, FROM THE
+        // PREVIOUS ONE PLUS AN EDIT
+        int prevBest = *min_element(prev.begin(), prev.end());
+        return best <= maxEdits_ || prevBest + 1 <= maxEdits_;
+    }
+
+    const IndexReader &index_;
+    string_view query_;
+    int maxEdits_;
+    TermExpansion &out_;
+    vector<vector<int>> rows_;
+};
+
+} // namespace
+
+int defaultFuzzyEdits(string_view term) {
+    return term.size() <= FUZZY_ONE_EDIT_MAX_LENGTH ? 1 : 2;
+}
+
+TermExpansion expandFuzzy(const IndexReader &index, string_view term, int maxEdits, size_t maxExpansions) {
+    TermExpansion result;
+    if (index.termCount() == 0) return result;
+    FuzzyWalk(index, term, min(max(maxEdits, 0), FUZZY_MAX_EDITS), result).run();
+    capExpansion(index, result, maxExpansions);
+    return result;
+}
@@ -0,0 +1,27 @@
+#ifndef _FUZZY_H_
+#define _FUZZY_H_
+
+#include <string_view>
+#include "binary_index.h"
+#include "wildcard.h"
+
+// FUZZY TERMS: EVERY INDEXED TERM WITHIN maxEdits EDITS OF A (STEMMED) QUERY TERM, WHERE AN EDIT IS
+// AN INSERTED, DELETED OR SUBSTITUTED LETTER OR TWO SWAPPED ADJACENT LETTERS ("netwrok" -> network).
+//
+// THE LEVENSHTEIN AUTOMATON OF THE QUERY TERM IS RUN OVER THE SORTED LEXICON AS IF IT WERE A TRIE:
+// TERMS SHARING A PREFIX ARE A CONTIGUOUS RANGE, SO EACH PREFIX IS ONE AUTOMATON STATE (ITS ROW OF
+// EDIT DISTANCES) AND A PREFIX WHOSE STATE CAN NO LONGER ACCEPT DROPS ITS WHOLE RANGE UNVISITED.
+// THE WORK IS PROPORTIONAL TO THE PREFIXES STILL WITHIN REACH, NOT TO THE VOCABULARY
+
+static const int FUZZY_MAX_EDITS = 2;
+
+// EDITS FOR A BARE word~: 1 FOR TERMS UP TO THIS LENGTH, 2 FOR LONGER ONES
+static const size_t FUZZY_ONE_EDIT_MAX_LENGTH = 5;
+
+int defaultFuzzyEdits(std::string_view term);
+
+// THE TERMS OF index WITHIN maxEdits (0..FUZZY_MAX_EDITS) OF term; COMMON GRAMS ARE NEVER EXPANDED TO
+TermExpansion expandFuzzy(const IndexReader &index, std::string_view term, int maxEdits,
+                          size_t maxExpansions = TERM_EXPANSION_LIMIT);
+
+#endif
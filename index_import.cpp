@@ -0,0 +1,316 @@
+#include "index_import.h"
+#include "binary_index.h"
+#include "mapped_file.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// BYTES OF JSON HANDED TO ONE WORKER AT A TIME
+static const size_t IMPORT_CHUNK_BYTES = 32 << 20;
+
+namespace {
+
+struct ImportedTerm {
+    string term;
+    size_t encodedOffset;
+    size_t encodedBytes;
+    uint32_t df;
+    uint64_t cf;
+};
+
+struct ChunkResult {
+    vector<ImportedTerm> terms;
+    string encoded;
+    size_t badLines = 0;
+    int maxDocId = 0;
+    // PARTIAL DOC LENGTHS (SUM OF TFS) OVER THIS CHUNK'S TERMS, ONE (DOC, LENGTH) PAIR PER DOC BY DOC ID.
+    // SPARSE, SO A CHUNK NEVER ALLOCATES BY ITS HIGHEST DOC ID
+    vector<pair<int, uint32_t>> docLengths;
+    bool commonGrams = false;     // SAW A COMMON GRAM TERM
+};
+
+// SCHEMA-SPECIALIZED PARSER FOR ONE INDEX LINE: {"term":[df,{"docID":[p,...]},...]}
+class LineParser {
+public:
+    LineParser(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+    bool parse(string &term, PostingList &postings) {
+        postings.clear();
+        postings.posStarts.push_back(0);
+        int declaredDf;
+        if (!expect('{') || !parseString(term) || !expect(':') || !expect('[') || !parseInt(declaredDf)) return false;
+
+        string docKey;
+        while (true) {
+            skipWs();
+            if (p_ < end_ && *p_ == ']') { ++p_; break; }
+            if (!expect(',') || !expect('{') || !parseString(docKey) || !expect(':') || !expect('[')) return false;
+
+            int docId;
+            auto res = from_chars(docKey.data(), docKey.data() + docKey.size(), docId);
+            if (res.ec != errc() || res.ptr != docKey.data() + docKey.size() || docId < 0) return false;
+            postings.docIds.push_back(docId);
+
+            skipWs();
+            if (p_ < end_ && *p_ == ']') {
+                ++p_;
+            } else {
+                while (true) {
+                    int pos;
+                    if (!parseInt(pos) || pos < 0) return false;
+                    postings.positions.push_back(pos);
+                    skipWs();
+                    if (p_ < end_ && *p_ == ',') { ++p_; continue; }
+                    if (!expect(']')) return false;
+                    break;
+                }
+            }
+            postings.posStarts.push_back((uint32_t)postings.positions.size());
+            if (!expect('}')) return false;
+        }
+        if (!expect('}')) return false;
+        skipWs();
+        // A TRUNCATED OR INCONSISTENT LINE WOULD OTHERWISE BE IMPORTED WITH A WRONG df
+        return p_ == end_ && (size_t)declaredDf == postings.size();
+    }
+
+private:
+    void skipWs() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) ++p_;
+    }
+
+    bool expect(char c) {
+        skipWs();
+        if (p_ >= end_ || *p_ != c) return false;
+        ++p_;
+        return true;
+    }
+
+    bool parseInt(int &value) {
+        skipWs();
+        auto res = from_chars(p_, end_, value);
+        if (res.ec != errc()) return false;
+        p_ = res.ptr;
+        return true;
+    }
+
+    static int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static void appendUtf8(string &out, uint32_t cp) {
+        if (cp < 0x80) {
+            out.push_back((char)cp);
+        } else if (cp < 0x800) {
+            out.push_back((char)(0xC0 | (cp >> 6)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        } else {
+            out.push_back((char)(0xE0 | (cp >> 12)));
+            out.push_back((char)(0x80 | ((cp >> 6) & 0x3F)));
+            out.push_back((char)(0x80 | (cp & 0x3F)));
+        }
+    }
+
+    bool parseString(string &out) {
+        out.clear();
+        if (!expect('"')) return false;
+        while (p_ < end_) {
+            char c = *p_++;
+            if (c == '"') return true;
+            if (c != '\\') { out.push_back(c); continue; }
+            if (p_ >= end_) return false;
+            char esc = *p_++;
+            switch (esc) {
+                case '"': out.push_back('"'); break;
+                case '\\': out.push_back('\\'); break;
+                case '/': out.push_back('/'); break;
+                case 'b': out.push_back('\b'); break;
+                case 'f': out.push_back('\f'); break;
+                case 'n': out.push_back('\n'); break;
+                case 'r': out.push_back('\r'); break;
+                case 't': out.push_back('\t'); break;
+                case 'u': {
+                    if (end_ - p_ < 4) return false;
+                    uint32_t cp = 0;
+                    for (int i = 0; i < 4; ++i) {
+                        int h = hexValue(*p_++);
+                        if (h < 0) return false;
+                        cp = (cp << 4) | (uint32_t)h;
+                    }
+                    appendUtf8(out, cp);
+                    break;
+                }
+                default: return false;
+            }
+        }
+        return false;
+    }
+
+    const char *p_;
+    const char *end_;
+};
+
+// HISTORIC FILES SHOULD ALREADY BE SORTED, BUT NEVER WRITE UNSORTED POSTINGS
+void normalizePostings(PostingList &postings) {
+    bool sorted = true;
+    for (size_t i = 1; i < postings.size() && sorted; ++i) sorted = postings.docIds[i - 1] < postings.docIds[i];
+    for (size_t i = 0; i < postings.size() && sorted; ++i) {
+        for (uint32_t k = postings.posStarts[i] + 1; k < postings.posStarts[i + 1]; ++k) {
+            if (postings.positions[k - 1] >= postings.positions[k]) { sorted = false; break; }
+        }
+    }
+    if (sorted) return;
+
+    vector<size_t> order(postings.size());
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return postings.docIds[a] < postings.docIds[b]; });
+
+    PostingList fixed;
+    fixed.posStarts.push_back(0);
+    for (size_t idx : order) {
+        vector<int> pos(postings.positions.begin() + postings.posStarts[idx],
+                        postings.positions.begin() + postings.posStarts[idx + 1]);
+        // DUPLICATE DOC ENTRIES ARE MERGED, AS mergeBlocksToIndex DOES
+        if (!fixed.docIds.empty() && fixed.docIds.back() == postings.docIds[idx]) {
+            fixed.posStarts.pop_back();
+        } else {
+            fixed.docIds.push_back(postings.docIds[idx]);
+        }
+        fixed.positions.insert(fixed.positions.end(), pos.begin(), pos.end());
+        sort(fixed.positions.begin() + fixed.posStarts.back(), fixed.positions.end());
+        fixed.positions.erase(unique(fixed.positions.begin() + fixed.posStarts.back(), fixed.positions.end()),
+                              fixed.positions.end());
+        fixed.posStarts.push_back((uint32_t)fixed.positions.size());
+    }
+    postings = move(fixed);
+}
+
+void processChunk(const char *begin, const char *end, ChunkResult &result) {
+    result = ChunkResult();
+    PostingList postings;
+    string term;
+    const char *lineStart = begin;
+    while (lineStart < end) {
+        const char *lineEnd = static_cast<const char *>(memchr(lineStart, '\n', end - lineStart));
+        if (lineEnd == nullptr) lineEnd = end;
+        const char *contentEnd = lineEnd;
+        if (contentEnd > lineStart && contentEnd[-1] == '\r') --contentEnd;
+
+        if (contentEnd > lineStart) {
+            LineParser parser(lineStart, contentEnd);
+            if (parser.parse(term, postings)) {
+                normalizePostings(postings);
+                ImportedTerm t;
+                t.term = term;
+                t.encodedOffset = result.encoded.size();
+                encodePostingList(postings, result.encoded);
+                t.encodedBytes = result.encoded.size() - t.encodedOffset;
+                t.df = (uint32_t)postings.size();
+                t.cf = postings.positions.size();
+                if (!postings.docIds.empty()) result.maxDocId = max(result.maxDocId, postings.docIds.back());
+                // GRAMS DO NOT COUNT TOWARDS THE DOC LENGTH
+                if (isCommonGram(term)) {
+                    result.commonGrams = true;
+                } else {
+                    for (size_t i = 0; i < postings.size(); ++i) {
+                        result.docLengths.push_back({postings.docIds[i], postings.tf(i)});
+                    }
+                }
+                result.terms.push_back(move(t));
+            } else {
+                result.badLines++;
+            }
+        }
+        lineStart = lineEnd + 1;
+    }
+
+    // ONE PAIR PER DOC
+    auto &lengths = result.docLengths;
+    sort(lengths.begin(), lengths.end(), [](const pair<int, uint32_t> &a, const pair<int, uint32_t> &b) {
+        return a.first < b.first;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < lengths.size(); ++i) {
+        if (kept > 0 && lengths[kept - 1].first == lengths[i].first) lengths[kept - 1].second += lengths[i].second;
+        else lengths[kept++] = lengths[i];
+    }
+    lengths.resize(kept);
+}
+
+} // namespace
+
+bool importJsonIndex(const string &jsonPath, const string &binPath, size_t numThreads, int maxDocId) {
+    MappedFile in;
+    if (!in.open(jsonPath)) return false;
+
+    // SPLIT AT NEWLINE BOUNDARIES
+    vector<size_t> chunkStarts;
+    size_t offset = 0;
+    while (offset < in.size()) {
+        chunkStarts.push_back(offset);
+        size_t target = min(in.size(), offset + IMPORT_CHUNK_BYTES);
+        const void *nl = target < in.size() ? memchr(in.data() + target, '\n', in.size() - target) : nullptr;
+        offset = nl ? (size_t)(static_cast<const char *>(nl) - in.data()) + 1 : in.size();
+    }
+    chunkStarts.push_back(in.size());
+    size_t numChunks = chunkStarts.size() - 1;
+
+    BinaryIndexWriter writer;
+    if (!writer.open(binPath)) return false;
+
+    numThreads = max<size_t>(1, numThreads);
+    vector<ChunkResult> results(max<size_t>(1, min(numThreads, numChunks)));
+    size_t termCount = 0, badLines = 0;
+    // A DOC'S LENGTH IS THE NUMBER OF POSITIONS IT HAS ACROSS ALL TERMS, AS COUNTED BY THE INDEXER
+    vector<uint32_t> docLengths(1, 0);
+    bool commonGrams = false;
+
+    for (size_t waveStart = 0; waveStart < numChunks; waveStart += results.size()) {
+        size_t waveSize = min(results.size(), numChunks - waveStart);
+        auto runChunk = [&](size_t slot) {
+            size_t c = waveStart + slot;
+            processChunk(in.data() + chunkStarts[c], in.data() + chunkStarts[c + 1], results[slot]);
+        };
+
+        vector<thread> workers;
+        for (size_t slot = 1; slot < waveSize; ++slot) workers.emplace_back(runChunk, slot);
+        runChunk(0);
+        for (auto &w : workers) w.join();
+
+        // APPEND IN FILE ORDER
+        for (size_t slot = 0; slot < waveSize; ++slot) {
+            const ChunkResult &r = results[slot];
+            if (r.maxDocId > maxDocId) {
+                cerr << "ERROR: DOC ID " << r.maxDocId << " IN " << jsonPath << " IS ABOVE THE LIMIT OF " << maxDocId
+                     << " (RAISE IT WITH --max-doc-id)" << endl;
+                return false;
+            }
+            for (const ImportedTerm &t : r.terms) {
+                string_view encoded(r.encoded.data() + t.encodedOffset, t.encodedBytes);
+                if (!writer.addTerm(t.term, encoded, t.df, t.cf)) return false;
+            }
+            termCount += r.terms.size();
+            badLines += r.badLines;
+            if ((size_t)r.maxDocId >= docLengths.size()) docLengths.resize((size_t)r.maxDocId + 1, 0);
+            for (const auto &doc : r.docLengths) docLengths[doc.first] += doc.second;
+            commonGrams = commonGrams || r.commonGrams;
+        }
+    }
+
+    if (commonGrams) writer.setFlags(BINARY_INDEX_FLAG_COMMON_GRAMS);
+    if (!writer.finish(docLengths)) return false;
+    if (badLines > 0) cerr << "WARNING: SKIPPED " << badLines << " MALFORMED LINES IN " << jsonPath << "\n";
+    cout << "IMPORTED " << termCount << " TERMS FROM " << jsonPath << " INTO " << binPath << "\n";
+    return true;
+}
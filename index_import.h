@@ -0,0 +1,18 @@
+#ifndef _INDEX_IMPORT_H_
+#define _INDEX_IMPORT_H_
+
+#include <cstddef>
+#include <string>
+
+// DEFAULT HIGHEST DOC ID AN IMPORT ACCEPTS. THE INDEX STORES DOC LENGTHS AS A DENSE ARRAY BY DOC ID
+// (4 BYTES PER ID, SO 1 GB HERE); A LARGER ID FAILS THE IMPORT RATHER THAN FORCING A HUGE ALLOCATION
+static const int IMPORT_MAX_DOC_ID = (1 << 28) - 1;
+
+// CONVERT AN EXISTING pos_inverted_index.json INTO THE BINARY INDEX FORMAT.
+// THE JSON FILE IS MEMORY-MAPPED AND SPLIT AT NEWLINE BOUNDARIES INTO CHUNKS THAT ARE PARSED
+// AND ENCODED ON numThreads WORKERS; ENCODED CHUNKS ARE APPENDED TO THE OUTPUT IN FILE ORDER.
+// FAILS (AFTER PRINTING AN ERROR) IF ANY DOC ID IS ABOVE maxDocId.
+bool importJsonIndex(const std::string &jsonPath, const std::string &binPath, size_t numThreads,
+                     int maxDocId = IMPORT_MAX_DOC_ID);
+
+#endif
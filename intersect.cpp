@@ -0,0 +1,356 @@
+#include "intersect.h"
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define INTERSECT_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+size_t gallopLowerBound(const int *list, size_t size, size_t from, int target) {
+    if (from >= size || list[from] >= target) return from;
+
+    // list[lo] < target IS INVARIANT; DOUBLE THE STEP UNTIL list[hi] >= target
+    size_t lo = from, step = 1, hi = from + 1;
+    while (hi < size && list[hi] < target) {
+        lo = hi;
+        step <<= 1;
+        hi = lo + step;
+    }
+    if (hi > size) hi = size;
+
+    // BINARY SEARCH IN (lo, hi]
+    ++lo;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (list[mid] < target) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// NOTE ON ALIASING: EVERY KERNEL WRITES out[count] ONLY AFTER READING a[count] AND ANY
+// EARLIER-INDEXED ELEMENT IT STILL NEEDS; OVERWRITTEN SLOTS ONLY EVER HOLD ALREADY EMITTED
+// VALUES, WHICH ARE SMALLER THAN EVERY TARGET STILL TO BE PROBED
+
+static size_t mergeScalar(const int *a, size_t na, const int *b, size_t nb, int shift, int *out,
+                          size_t i = 0, size_t j = 0, size_t count = 0) {
+    while (i < na && j < nb) {
+        int want = a[i] + shift;
+        if (b[j] < want) {
+            ++j;
+        } else if (b[j] > want) {
+            ++i;
+        } else {
+            out[count++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+static size_t mergeGallop(const int *a, size_t na, const int *b, size_t nb, int shift, int *out,
+                          size_t i = 0, size_t j = 0, size_t count = 0) {
+    while (i < na && j < nb) {
+        int want = a[i] + shift;
+        if (b[j] < want) {
+            j = gallopLowerBound(b, nb, j, want);
+        } else if (b[j] > want) {
+            i = gallopLowerBound(a, na, i, b[j] - shift);
+        } else {
+            out[count++] = a[i];
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+#ifdef INTERSECT_X86
+
+static inline int popcount32(unsigned v) {
+#ifdef _MSC_VER
+    return (int)__popcnt(v);
+#else
+    return __builtin_popcount(v);
+#endif
+}
+
+static inline int lowestBit(unsigned v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, v);
+    return (int)idx;
+#else
+    return __builtin_ctz(v);
+#endif
+}
+
+// EMIT THE LANES OF block SELECTED BY mask, IN LANE ORDER
+static inline size_t emitLanes(const int *block, unsigned mask, int *out, size_t count) {
+    while (mask) {
+        out[count++] = block[lowestBit(mask)];
+        mask &= mask - 1;
+    }
+    return count;
+}
+
+TARGET_SSE41 static size_t blockSse41(const int *a, size_t na, const int *b, size_t nb, int shift, int *out) {
+    size_t i = 0, j = 0, count = 0;
+    if (na >= 4 && nb >= 4) {
+        const __m128i vshift = _mm_set1_epi32(shift);
+        alignas(16) int aLanes[4];
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+        _mm_store_si128(reinterpret_cast<__m128i *>(aLanes), va);
+        __m128i vb = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b)), vshift);
+        while (true) {
+            // COMPARE EVERY a LANE AGAINST EVERY ROTATION OF THE b BLOCK
+            __m128i hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi32(va, vb), _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1)))),
+                _mm_or_si128(_mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2))),
+                             _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, _MM_SHUFFLE(2, 1, 0, 3)))));
+            unsigned mask = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(hits));
+            int aMax = aLanes[3];
+            int bMax = b[j + 3] - shift;
+            count = emitLanes(aLanes, mask, out, count);
+
+            if (aMax <= bMax) {
+                i += 4;
+                if (i + 4 > na) {
+                    if (aMax == bMax) j += 4;
+                    break;
+                }
+                va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a + i));
+                _mm_store_si128(reinterpret_cast<__m128i *>(aLanes), va);
+            }
+            if (bMax <= aMax) {
+                j += 4;
+                if (j + 4 > nb) break;
+                vb = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(b + j)), vshift);
+            }
+        }
+    }
+    return mergeScalar(a, na, b, nb, shift, out, i, j, count);
+}
+
+TARGET_AVX2 static size_t blockAvx2(const int *a, size_t na, const int *b, size_t nb, int shift, int *out) {
+    size_t i = 0, j = 0, count = 0;
+    if (na >= 8 && nb >= 8) {
+        const __m256i vshift = _mm256_set1_epi32(shift);
+        const __m256i rot1 = _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0);
+        const __m256i rot2 = _mm256_setr_epi32(2, 3, 4, 5, 6, 7, 0, 1);
+        const __m256i rot3 = _mm256_setr_epi32(3, 4, 5, 6, 7, 0, 1, 2);
+        alignas(32) int aLanes[8];
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a));
+        _mm256_store_si256(reinterpret_cast<__m256i *>(aLanes), va);
+        __m256i vb = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b)), vshift);
+        while (true) {
+            // ROTATIONS 0-3 OF b, AND THE SAME FOUR WITH 128-BIT HALVES SWAPPED, COVER ALL 8
+            __m256i r1 = _mm256_permutevar8x32_epi32(vb, rot1);
+            __m256i r2 = _mm256_permutevar8x32_epi32(vb, rot2);
+            __m256i r3 = _mm256_permutevar8x32_epi32(vb, rot3);
+            __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi32(va, vb), _mm256_cmpeq_epi32(va, r1)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi32(va, r2), _mm256_cmpeq_epi32(va, r3)));
+            hits = _mm256_or_si256(hits, _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_permute2x128_si256(vb, vb, 1)),
+                                _mm256_cmpeq_epi32(va, _mm256_permute2x128_si256(r1, r1, 1))),
+                _mm256_or_si256(_mm256_cmpeq_epi32(va, _mm256_permute2x128_si256(r2, r2, 1)),
+                                _mm256_cmpeq_epi32(va, _mm256_permute2x128_si256(r3, r3, 1)))));
+            unsigned mask = (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(hits));
+            int aMax = aLanes[7];
+            int bMax = b[j + 7] - shift;
+            count = emitLanes(aLanes, mask, out, count);
+
+            if (aMax <= bMax) {
+                i += 8;
+                if (i + 8 > na) {
+                    if (aMax == bMax) j += 8;
+                    break;
+                }
+                va = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(a + i));
+                _mm256_store_si256(reinterpret_cast<__m256i *>(aLanes), va);
+            }
+            if (bMax <= aMax) {
+                j += 8;
+                if (j + 8 > nb) break;
+                vb = _mm256_sub_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b + j)), vshift);
+            }
+        }
+    }
+    return mergeScalar(a, na, b, nb, shift, out, i, j, count);
+}
+
+// FIRST BLOCK START j' = j + k * width (k >= 0) WHOSE LAST ELEMENT IS >= target, OR WHOSE BLOCK
+// RUNS PAST THE END OF THE LIST. GALLOPS OVER BLOCKS SO LONG SKIPS COST O(log d)
+static inline size_t skipBlocks(const int *list, size_t size, size_t j, int target, size_t width) {
+    auto tooSmall = [&](size_t k) { return j + k * width + width <= size && list[j + k * width + width - 1] < target; };
+    if (!tooSmall(0)) return j;
+    size_t lo = 0, hi = 1;
+    while (tooSmall(hi)) {
+        lo = hi;
+        hi <<= 1;
+    }
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tooSmall(mid)) lo = mid;
+        else hi = mid;
+    }
+    return j + hi * width;
+}
+
+// SKEWED KERNELS PROBE EACH ELEMENT OF THE SMALL LIST IN THE LARGE ONE. A PROBE FOR small[k]
+// LOOKS FOR small[k] + probeShift IN large AND EMITS THE FOUND VALUE MINUS emitOffset, WHICH IS
+// ALWAYS THE MATCHING ELEMENT OF a
+TARGET_SSE41 static size_t probeSse41V1(const int *small, size_t ns, const int *large, size_t nl,
+                                        int probeShift, int emitOffset, int *out) {
+    size_t j = 0, count = 0;
+    for (size_t k = 0; k < ns && j < nl; ++k) {
+        int target = small[k] + probeShift;
+        j = skipBlocks(large, nl, j, target, 4);
+        if (j + 4 <= nl) {
+            __m128i eq = _mm_cmpeq_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(large + j)),
+                                         _mm_set1_epi32(target));
+            if (!_mm_testz_si128(eq, eq)) out[count++] = target - emitOffset;
+        } else {
+            while (j < nl && large[j] < target) ++j;
+            if (j < nl && large[j] == target) out[count++] = target - emitOffset;
+        }
+    }
+    return count;
+}
+
+TARGET_AVX2 static size_t probeAvx2V3(const int *small, size_t ns, const int *large, size_t nl,
+                                      int probeShift, int emitOffset, int *out) {
+    size_t j = 0, count = 0;
+    for (size_t k = 0; k < ns && j < nl; ++k) {
+        int target = small[k] + probeShift;
+        // SKIP 32-ELEMENT BLOCKS, THEN TEST THE WHOLE BLOCK WITH FOUR COMPARES
+        j = skipBlocks(large, nl, j, target, 32);
+        if (j + 32 <= nl) {
+            const __m256i vt = _mm256_set1_epi32(target);
+            const __m256i *blk = reinterpret_cast<const __m256i *>(large + j);
+            __m256i eq = _mm256_or_si256(
+                _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256(blk), vt),
+                                _mm256_cmpeq_epi32(_mm256_loadu_si256(blk + 1), vt)),
+                _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_loadu_si256(blk + 2), vt),
+                                _mm256_cmpeq_epi32(_mm256_loadu_si256(blk + 3), vt)));
+            if (!_mm256_testz_si256(eq, eq)) out[count++] = target - emitOffset;
+        } else {
+            j = skipBlocks(large, nl, j, target, 8);
+            if (j + 8 <= nl) {
+                __m256i eq = _mm256_cmpeq_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(large + j)),
+                                                _mm256_set1_epi32(target));
+                if (!_mm256_testz_si256(eq, eq)) out[count++] = target - emitOffset;
+            } else {
+                while (j < nl && large[j] < target) ++j;
+                if (j < nl && large[j] == target) out[count++] = target - emitOffset;
+            }
+        }
+    }
+    return count;
+}
+
+struct CpuFeatures {
+    bool sse41 = false;
+    bool avx2 = false;
+
+    CpuFeatures() {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        int maxLeaf = info[0];
+        __cpuid(info, 1);
+        sse41 = (info[2] & (1 << 19)) != 0;
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (maxLeaf >= 7 && osxsave && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+#else
+        __builtin_cpu_init();
+        sse41 = __builtin_cpu_supports("sse4.1");
+        avx2 = __builtin_cpu_supports("avx2");
+#endif
+    }
+};
+
+static const CpuFeatures &cpuFeatures() {
+    static const CpuFeatures features;
+    return features;
+}
+
+#endif // INTERSECT_X86
+
+const char *intersectKernelName(IntersectKernel kernel) {
+    switch (kernel) {
+        case IntersectKernel::SCALAR_MERGE: return "scalar-merge";
+        case IntersectKernel::GALLOP: return "gallop";
+        case IntersectKernel::SSE41_BLOCK: return "sse4.1-block";
+        case IntersectKernel::AVX2_BLOCK: return "avx2-block";
+        case IntersectKernel::SSE41_V1: return "sse4.1-v1";
+        case IntersectKernel::AVX2_V3: return "avx2-v3";
+    }
+    return "unknown";
+}
+
+bool intersectKernelSupported(IntersectKernel kernel) {
+    switch (kernel) {
+        case IntersectKernel::SCALAR_MERGE:
+        case IntersectKernel::GALLOP:
+            return true;
+#ifdef INTERSECT_X86
+        case IntersectKernel::SSE41_BLOCK:
+        case IntersectKernel::SSE41_V1:
+            return cpuFeatures().sse41;
+        case IntersectKernel::AVX2_BLOCK:
+        case IntersectKernel::AVX2_V3:
+            return cpuFeatures().avx2;
+#endif
+        default:
+            return false;
+    }
+}
+
+size_t intersectShiftedWith(IntersectKernel kernel, const int *a, size_t na, const int *b, size_t nb,
+                            int shift, int *out) {
+    if (na == 0 || nb == 0) return 0;
+    switch (kernel) {
+        case IntersectKernel::SCALAR_MERGE: return mergeScalar(a, na, b, nb, shift, out);
+        case IntersectKernel::GALLOP: return mergeGallop(a, na, b, nb, shift, out);
+#ifdef INTERSECT_X86
+        case IntersectKernel::SSE41_BLOCK: return blockSse41(a, na, b, nb, shift, out);
+        case IntersectKernel::AVX2_BLOCK: return blockAvx2(a, na, b, nb, shift, out);
+        case IntersectKernel::SSE41_V1:
+            return na <= nb ? probeSse41V1(a, na, b, nb, shift, shift, out)
+                            : probeSse41V1(b, nb, a, na, -shift, 0, out);
+        case IntersectKernel::AVX2_V3:
+            return na <= nb ? probeAvx2V3(a, na, b, nb, shift, shift, out)
+                            : probeAvx2V3(b, nb, a, na, -shift, 0, out);
+#endif
+        default:
+            return mergeGallop(a, na, b, nb, shift, out);
+    }
+}
+
+size_t intersectShifted(const int *a, size_t na, const int *b, size_t nb, int shift, int *out) {
+    // BEST KERNEL PER SHAPE, RESOLVED ONCE
+    static const IntersectKernel blockKernel =
+        intersectKernelSupported(IntersectKernel::AVX2_BLOCK) ? IntersectKernel::AVX2_BLOCK
+        : intersectKernelSupported(IntersectKernel::SSE41_BLOCK) ? IntersectKernel::SSE41_BLOCK
+        : IntersectKernel::SCALAR_MERGE;
+    static const IntersectKernel skewedKernel =
+        intersectKernelSupported(IntersectKernel::AVX2_V3) ? IntersectKernel::AVX2_V3
+        : intersectKernelSupported(IntersectKernel::SSE41_V1) ? IntersectKernel::SSE41_V1
+        : IntersectKernel::GALLOP;
+
+    bool skewed = na * INTERSECT_SKEW_RATIO < nb || nb * INTERSECT_SKEW_RATIO < na;
+    return intersectShiftedWith(skewed ? skewedKernel : blockKernel, a, na, b, nb, shift, out);
+}
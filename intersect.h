@@ -0,0 +1,45 @@
+#ifndef _INTERSECT_H_
+#define _INTERSECT_H_
+
+#include <cstddef>
+
+// SORTED INTEGER LIST INTERSECTION FOR DOC-ID AND POSITION LISTS
+
+// FIRST INDEX i >= from WITH list[i] >= target, OR size IF NONE.
+// EXPONENTIAL SEARCH FROM from FOLLOWED BY A BINARY SEARCH INSIDE THE LAST STEP, SO NEARBY
+// TARGETS COST O(1) AND A JUMP OF d ELEMENTS COSTS O(log d)
+size_t gallopLowerBound(const int *list, size_t size, size_t from, int target);
+
+// AVAILABLE INTERSECTION KERNELS
+enum class IntersectKernel {
+    SCALAR_MERGE,  // BRANCHY LINEAR MERGE
+    GALLOP,        // TWO-SIDED GALLOPING MERGE (SCALAR FALLBACK FOR SKEWED SIZES)
+    SSE41_BLOCK,   // 4x4 ALL-PAIRS BLOCK COMPARE
+    AVX2_BLOCK,    // 8x8 ALL-PAIRS BLOCK COMPARE
+    SSE41_V1,      // SKEWED: EACH SMALL-LIST ELEMENT GALLOPS TO A 4-WIDE BLOCK OF THE LARGE LIST
+    AVX2_V3        // SKEWED: GALLOPS OVER 32-ELEMENT BLOCKS, THEN FOUR 8-WIDE COMPARES
+};
+
+// SIZE RATIO ABOVE WHICH THE SKEWED KERNEL IS USED
+static const size_t INTERSECT_SKEW_RATIO = 32;
+
+const char *intersectKernelName(IntersectKernel kernel);
+
+// TRUE IF THE CPU (AND BUILD) CAN RUN THE KERNEL
+bool intersectKernelSupported(IntersectKernel kernel);
+
+// KEEP EVERY x OF a FOR WHICH x + shift OCCURS IN b; BOTH LISTS SORTED AND UNIQUE.
+// WRITES THE SURVIVORS TO out (WHICH MAY ALIAS a) AND RETURNS THEIR COUNT.
+// PICKS THE BEST SUPPORTED KERNEL FOR THE SIZE RATIO (SELECTED ONCE AT RUNTIME)
+size_t intersectShifted(const int *a, size_t na, const int *b, size_t nb, int shift, int *out);
+
+// SAME CONTRACT WITH AN EXPLICIT KERNEL, WHICH MUST BE SUPPORTED
+size_t intersectShiftedWith(IntersectKernel kernel, const int *a, size_t na, const int *b, size_t nb,
+                            int shift, int *out);
+
+// PLAIN DOC-ID INTERSECTION
+inline size_t intersectSorted(const int *a, size_t na, const int *b, size_t nb, int *out) {
+    return intersectShifted(a, na, b, nb, 0, out);
+}
+
+#endif
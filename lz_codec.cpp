@@ -0,0 +1,105 @@
+#include "lz_codec.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+const int LZ_HASH_BITS = 14;
+
+uint32_t read32(const char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash4(const char *p) {
+    return (read32(p) * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+void appendLength(string &out, size_t length) {
+    while (length >= 255) {
+        out.push_back((char)255);
+        length -= 255;
+    }
+    out.push_back((char)length);
+}
+
+void appendSequence(string &out, const char *literals, size_t literalCount, size_t offset, size_t matchLength) {
+    size_t matchCode = matchLength >= LZ_MIN_MATCH ? matchLength - LZ_MIN_MATCH : 0;
+    uint8_t token = (uint8_t)((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+    out.push_back((char)token);
+    if (literalCount >= 15) appendLength(out, literalCount - 15);
+    out.append(literals, literalCount);
+    if (matchLength == 0) return;  // LAST SEQUENCE
+    out.push_back((char)(offset & 0xFF));
+    out.push_back((char)(offset >> 8));
+    if (matchCode >= 15) appendLength(out, matchCode - 15);
+}
+
+// READ A LENGTH EXTENSION; FALSE IF THE INPUT RUNS OUT
+bool readLength(const uint8_t *&p, const uint8_t *end, size_t &length) {
+    uint8_t byte;
+    do {
+        if (p == end) return false;
+        byte = *p++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+} // namespace
+
+void lzCompress(const char *data, size_t size, string &out) {
+    vector<int64_t> table((size_t)1 << LZ_HASH_BITS, -1);
+    size_t anchor = 0, i = 0;
+    while (i + LZ_MIN_MATCH <= size) {
+        uint32_t h = hash4(data + i);
+        int64_t candidate = table[h];
+        table[h] = (int64_t)i;
+        if (candidate >= 0 && i - (size_t)candidate <= LZ_MAX_OFFSET && read32(data + candidate) == read32(data + i)) {
+            size_t length = LZ_MIN_MATCH;
+            while (i + length < size && data[candidate + length] == data[i + length]) ++length;
+            appendSequence(out, data + anchor, i - anchor, i - (size_t)candidate, length);
+            i += length;
+            anchor = i;
+        } else {
+            ++i;
+        }
+    }
+    appendSequence(out, data + anchor, size - anchor, 0, 0);
+}
+
+bool lzDecompress(const char *in, size_t inSize, char *out, size_t rawSize) {
+    const uint8_t *p = reinterpret_cast<const uint8_t *>(in);
+    const uint8_t *end = p + inSize;
+    size_t o = 0;
+    while (p < end) {
+        uint8_t token = *p++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(p, end, literals)) return false;
+        if ((size_t)(end - p) < literals || rawSize - o < literals) return false;
+        memcpy(out + o, p, literals);
+        p += literals;
+        o += literals;
+        if (p == end) break;  // LAST SEQUENCE
+
+        if (end - p < 2) return false;
+        size_t offset = p[0] | (size_t)p[1] << 8;
+        p += 2;
+        size_t length = token & 0x0F;
+        if (length == 15 && !readLength(p, end, length)) return false;
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > o || rawSize - o < length) return false;
+        if (offset >= length) {
+            memcpy(out + o, out + o - offset, length);
+            o += length;
+        } else {
+            // BYTE BY BYTE: THE MATCH OVERLAPS THE BYTES IT PRODUCES
+            for (size_t k = 0; k < length; ++k, ++o) out[o] = out[o - offset];
+        }
+    }
+    return o == rawSize;
+}
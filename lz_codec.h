@@ -0,0 +1,25 @@
+#ifndef _LZ_CODEC_H_
+#define _LZ_CODEC_H_
+
+#include <cstddef>
+#include <string>
+
+// SMALL LZ77 BYTE CODEC (LZ4-STYLE SEQUENCES) FOR THE DOC STORE. A SEQUENCE IS
+//   TOKEN     HIGH NIBBLE: LITERAL COUNT, LOW NIBBLE: MATCH LENGTH - LZ_MIN_MATCH (15 = MORE FOLLOWS)
+//   [255...]  LITERAL COUNT EXTENSION BYTES, ADDED WHILE THEY ARE 255
+//   LITERALS
+//   OFFSET    uint16 LITTLE-ENDIAN DISTANCE BACK TO THE MATCH (1..65535)
+//   [255...]  MATCH LENGTH EXTENSION BYTES
+// THE LAST SEQUENCE STOPS AFTER ITS LITERALS. MATCHES ARE FOUND THROUGH A HASH OF THE NEXT
+// 4 BYTES (ONE CANDIDATE PER SLOT), WHICH IS FAST AND GOOD ENOUGH FOR TEXT
+
+static const size_t LZ_MIN_MATCH = 4;
+static const size_t LZ_MAX_OFFSET = 65535;
+
+// APPEND THE COMPRESSED FORM OF data[0 .. size) TO out
+void lzCompress(const char *data, size_t size, std::string &out);
+
+// DECOMPRESS EXACTLY rawSize BYTES INTO out; FALSE ON CORRUPT INPUT
+bool lzDecompress(const char *in, size_t inSize, char *out, size_t rawSize);
+
+#endif
@@ -3,61 +3,106 @@
 #include <sstream>
 #include <filesystem>
 #include <map>
+#include <memory>
 #include <vector>
 #include <set>
 #include <algorithm>
 #include <string>
 #include <cctype>
 #include <chrono>
+#include <charconv>
+#include <thread>
 #include "json.hpp"
-#include "porter2_stemmer.h"
+#include "tokenizer.h"
+#include "binary_index.h"
+#include "index_import.h"
+#include "doc_offsets.h"
+#include "doc_store.h"
+#include "doc_table.h"
+#include "query_engine.h"
+#include "query_planner.h"
+#include "ranking.h"
+#include "snippet.h"
+#include "batch_query.h"
+#include "query_server.h"
+#include "sharded_query.h"
+#include "thread_pool.h"
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 using namespace std;
 
-// STOP WORDS - LOWERCASE
-static const set<string> STOP_WORDS = {
-    "the", "and", "is", "in", "to", "of", "that", "it", "for", "as", "with", 
-        "was", "this", "but", "be", "on", "by", "not", "he", "she", "or", "are", 
-        "at", "from", "his", "her", "they", "an", "will", "would", "which", "we"
-};
-
 // BLOCK TERM LIMIT - WHEN DICTIONARY REACHES THIS NUMBER OF UNIQUE TERMS, FLUSH TO DISK
 static const size_t BLOCK_TERM_LIMIT = 2500;
 
-// CLEAN A WORD: KEEP ONLY ALPHABETIC CHARS, CONVERT TO LOWERCASE
-string cleanWord(const string &word) {
-    string out;
-    out.reserve(word.size());
-    for (char c : word) {
-        if (isalpha(static_cast<unsigned char>(c))) {
-            out.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+// STREAMING JSON OUTPUT BUFFER SIZE - FLUSHED TO THE STREAM WHEN EXCEEDED
+static const size_t JSON_OUT_BUFFER_BYTES = 8 << 20;
+
+// BIWORDS (ADJACENT STEM PAIRS) IN FEWER DOCS THAN THIS ARE LEFT OUT OF THE BIWORD INDEX
+static const int DEFAULT_BIWORD_MIN_DF = 16;
+
+// TARGET NUMBER OF POSITIONS RENDERED PER PARALLEL CHUNK WHEN WRITING THE FINAL INDEX
+static const size_t JSON_CHUNK_POSITIONS = 1 << 20;
+
+// APPEND AN INTEGER TO THE BUFFER WITHOUT TEMPORARY STRINGS
+static inline void appendInt(string &buf, int value) {
+    char digits[16];
+    auto res = to_chars(digits, digits + sizeof(digits), value);
+    buf.append(digits, res.ptr);
+}
+
+// APPEND A JSON STRING LITERAL (SAME ESCAPING AS nlohmann::json::dump)
+static void appendJsonString(string &buf, const string &s) {
+    static const char HEX[] = "0123456789abcdef";
+    buf.push_back('"');
+    for (char c : s) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        switch (c) {
+            case '"':  buf.append("\\\""); break;
+            case '\\': buf.append("\\\\"); break;
+            case '\b': buf.append("\\b"); break;
+            case '\f': buf.append("\\f"); break;
+            case '\n': buf.append("\\n"); break;
+            case '\r': buf.append("\\r"); break;
+            case '\t': buf.append("\\t"); break;
+            default:
+                if (uc < 0x20) {
+                    buf.append("\\u00");
+                    buf.push_back(HEX[uc >> 4]);
+                    buf.push_back(HEX[uc & 0xF]);
+                } else {
+                    buf.push_back(c);
+                }
         }
     }
-    return out;
+    buf.push_back('"');
 }
 
-// TOKENIZE TEXT: RETURN VECTOR OF (CLEANED_WORD, POSITION)
-vector<pair<string,int>> tokenizeWithPositions(const string &text) {
-    vector<pair<string,int>> tokens;
-    string token;
-    stringstream ss(text);
-    int pos = 0;
-    while (ss >> token) {
-        string cleaned = cleanWord(token);
-            if (cleaned.size() > 2 && STOP_WORDS.find(cleaned) == STOP_WORDS.end()) {
-                Porter2Stemmer::stem(cleaned); 
-                tokens.emplace_back(cleaned, pos);
-            }
-        pos++;
+// APPEND ONE INDEX LINE: {"term":[df,{"docID":[positions]},...]}
+static void appendTermLine(string &buf, const string &term, const map<int, vector<int>> &postings) {
+    buf.push_back('{');
+    appendJsonString(buf, term);
+    buf.append(":[");
+    appendInt(buf, (int)postings.size());
+    for (const auto &docEntry : postings) {
+        buf.append(",{\"");
+        appendInt(buf, docEntry.first);
+        buf.append("\":[");
+        bool first = true;
+        for (int p : docEntry.second) {
+            if (!first) buf.push_back(',');
+            appendInt(buf, p);
+            first = false;
+        }
+        buf.append("]}");
     }
-    return tokens;
+    buf.append("]}\n");
 }
 
 // WRITE A SINGLE SPIMI BLOCK TO DISK (ONE TERM PER LINE, JSON FORMAT)
-void writeBlockToDisk(const map<string, map<int, vector<int>>> &blockIndex, int blockNumber) {
-    string filename = "spimi_block_" + to_string(blockNumber) + ".jsonl";
+void writeBlockToDisk(const map<string, map<int, vector<int>>> &blockIndex, int blockNumber,
+                      const string &prefix = "spimi_block_") {
+    string filename = prefix + to_string(blockNumber) + ".jsonl";
     ofstream out(filename);
     if (!out.is_open()) {
         cerr << "ERROR OPENING BLOCK FILE FOR WRITING: " << filename << endl;
@@ -65,30 +110,25 @@ void writeBlockToDisk(const map<string, map<int, vector<int>>> &blockIndex, int
     }
 
     // WRITE EACH TERM AS A SINGLE JSON OBJECT LINE
+    string buf;
+    buf.reserve(JSON_OUT_BUFFER_BYTES + 4096);
+    map<int, vector<int>> sortedPostings;
     for (const auto &termEntry : blockIndex) {
-        const string &term = termEntry.first;
-        const auto &postings = termEntry.second;
-
-        json j;
-        // FIRST ELEMENT: NUMBER OF DOCUMENTS CONTAINING THE TERM
-        j[term].push_back((int)postings.size());
-
-        // FOLLOWING ELEMENTS: OBJECTS MAPPING docID -> [positions]
-        for (const auto &docEntry : postings) {
-            int docID = docEntry.first;
-            const vector<int> &positions = docEntry.second;
-            // ENSURE POSITIONS ARE SORTED AND UNIQUE
-            vector<int> sortedPositions = positions;
-            sort(sortedPositions.begin(), sortedPositions.end());
-            sortedPositions.erase(unique(sortedPositions.begin(), sortedPositions.end()), sortedPositions.end());
-
-            json postingObj;
-            postingObj[to_string(docID)] = sortedPositions;
-            j[term].push_back(postingObj);
+        // ENSURE POSITIONS ARE SORTED AND UNIQUE
+        sortedPostings = termEntry.second;
+        for (auto &docEntry : sortedPostings) {
+            vector<int> &positions = docEntry.second;
+            sort(positions.begin(), positions.end());
+            positions.erase(unique(positions.begin(), positions.end()), positions.end());
         }
 
-        out << j.dump() << "\n";
+        appendTermLine(buf, termEntry.first, sortedPostings);
+        if (buf.size() >= JSON_OUT_BUFFER_BYTES) {
+            out.write(buf.data(), (streamsize)buf.size());
+            buf.clear();
+        }
     }
+    out.write(buf.data(), (streamsize)buf.size());
 
     out.close();
     cout << "WRITTEN SPIMI BLOCK TO DISK: " << filename << " (TERMS: " << blockIndex.size() << ")\n";
@@ -145,6 +185,8 @@ map<string, map<int, vector<int>>> mergeBlocksToIndex(const vector<string> &bloc
 }
 
 // WRITE FINAL pos_inverted_index.json (ONE TERM PER LINE, MATCHING ASSIGNMENT FORMAT)
+// TERMS ARE SPLIT INTO CHUNKS OF ROUGHLY JSON_CHUNK_POSITIONS POSITIONS; EACH WAVE OF CHUNKS IS
+// RENDERED IN PARALLEL INTO PRIVATE BUFFERS AND THEN WRITTEN IN TERM ORDER
 void writeFinalIndexToFile(const map<string, map<int, vector<int>>> &index, const string &outFilename) {
     ofstream out(outFilename);
     if (!out.is_open()) {
@@ -152,61 +194,45 @@ void writeFinalIndexToFile(const map<string, map<int, vector<int>>> &index, cons
         return;
     }
 
-    for (const auto &termEntry : index) {
-        const string &term = termEntry.first;
-        const auto &postings = termEntry.second;
-
-        json j;
-        j[term].push_back((int)postings.size());
-        for (const auto &docEntry : postings) {
-            int docID = docEntry.first;
-            const vector<int> &positions = docEntry.second;
-            json postingObj;
-            postingObj[to_string(docID)] = positions;
-            j[term].push_back(postingObj);
+    using TermIt = map<string, map<int, vector<int>>>::const_iterator;
+    vector<TermIt> chunkStarts;
+    size_t chunkPositions = 0;
+    for (TermIt it = index.begin(); it != index.end(); ++it) {
+        if (chunkStarts.empty() || chunkPositions >= JSON_CHUNK_POSITIONS) {
+            chunkStarts.push_back(it);
+            chunkPositions = 0;
         }
-
-        out << j.dump() << "\n";
+        for (const auto &docEntry : it->second) chunkPositions += docEntry.second.size() + 1;
     }
+    chunkStarts.push_back(index.end());
+    size_t numChunks = chunkStarts.size() - 1;
+
+    size_t numThreads = max<size_t>(1, thread::hardware_concurrency());
+    vector<string> buffers(min(numThreads, numChunks));
+
+    for (size_t waveStart = 0; waveStart < numChunks; waveStart += buffers.size()) {
+        size_t waveSize = min(buffers.size(), numChunks - waveStart);
+        auto renderChunk = [&](size_t slot) {
+            string &buf = buffers[slot];
+            buf.clear();
+            for (TermIt it = chunkStarts[waveStart + slot]; it != chunkStarts[waveStart + slot + 1]; ++it) {
+                appendTermLine(buf, it->first, it->second);
+            }
+        };
 
-    out.close();
-    cout << "FINAL INDEX WRITTEN TO: " << outFilename << "\n";
-}
+        vector<thread> workers;
+        for (size_t slot = 1; slot < waveSize; ++slot) workers.emplace_back(renderChunk, slot);
+        renderChunk(0);
+        for (auto &w : workers) w.join();
 
-// CHECK IF QUERY PHRASE OCCURS SEQUENTIALLY IN DOCUMENT (USING THE IN-MEMORY INDEX)
-bool phraseExistsInDoc(const vector<pair<string,int>> &queryTokens,
-                       const map<string, map<int, vector<int>>> &index,
-                       int docId) {
-    if (queryTokens.empty()) return false;
-    const string &firstWord = queryTokens[0].first;
-    // FIRST WORD MUST EXIST IN DOC
-    auto itFirstTerm = index.find(firstWord);
-    if (itFirstTerm == index.end()) return false;
-    auto itDoc = itFirstTerm->second.find(docId);
-    if (itDoc == itFirstTerm->second.end()) return false;
-    vector<int> prevPositions = itDoc->second;
-
-    // FOR EACH NEXT WORD, KEEP ONLY POSITIONS THAT ARE +1 OF PREVIOUS
-    for (size_t i = 1; i < queryTokens.size(); ++i) {
-        const string &currWord = queryTokens[i].first;
-        auto itTerm = index.find(currWord);
-        if (itTerm == index.end()) return false;
-        auto itTermDoc = itTerm->second.find(docId);
-        if (itTermDoc == itTerm->second.end()) return false;
-        const vector<int> &currPositions = itTermDoc->second;
-
-        vector<int> nextPositions;
-        for (int p : prevPositions) {
-            if (binary_search(currPositions.begin(), currPositions.end(), p + 1)) {
-                nextPositions.push_back(p + 1);
-            }
+        // ORDERED CONCATENATION
+        for (size_t slot = 0; slot < waveSize; ++slot) {
+            out.write(buffers[slot].data(), (streamsize)buffers[slot].size());
         }
-
-        if (nextPositions.empty()) return false;
-        prevPositions = move(nextPositions);
     }
 
-    return true;
+    out.close();
+    cout << "FINAL INDEX WRITTEN TO: " << outFilename << "\n";
 }
 
 // UTILITY: LIST SPIMI BLOCK FILES IN CWD
@@ -223,7 +249,169 @@ vector<string> findSpimiBlockFiles() {
     return files;
 }
 
-int main() {
+// READ A LIST OF TWO-WORD PHRASES (ONE PER LINE) TO ALWAYS KEEP IN THE BIWORD INDEX, AS "stem stem" KEYS
+set<string> loadBiwordList(const string &path) {
+    set<string> keys;
+    ifstream in(path);
+    if (!in.is_open()) {
+        cerr << "ERROR OPENING BIWORD LIST: " << path << endl;
+        return keys;
+    }
+    string line;
+    while (getline(in, line)) {
+        auto tokens = tokenizeWithPositions(line);
+        if (tokens.size() == 2 && tokens[1].second == tokens[0].second + 1) {
+            keys.insert(tokens[0].first + " " + tokens[1].first);
+        } else if (!tokens.empty()) {
+            cerr << "WARNING: NOT TWO ADJACENT INDEXABLE WORDS, IGNORED: " << line << "\n";
+        }
+    }
+    return keys;
+}
+
+int main(int argc, char *argv[]) {
+    // COMMAND LINE OPTIONS
+    string importJsonFile;
+    int importMaxDocId = IMPORT_MAX_DOC_ID;
+    string importDocsCsv;
+    string binaryIndexFile = "pos_inverted_index.bin";
+    string docTableFile = "docId_filePath_mapping.bin";
+    size_t numThreads = max(1u, thread::hardware_concurrency());
+    size_t inFlight = 0;
+    size_t shards = 1;  // > 1: SPLIT A FULL UNRANKED QUERY INTO DOC-ID RANGES RUN IN PARALLEL
+    size_t topK = 0;  // 0: UNRANKED BOOLEAN RESULTS
+    size_t firstN = 0;  // 0: ALL UNRANKED MATCHES
+    bool countOnly = false;
+    bool explain = false;
+    string batchFile;
+    string batchOutFile = "batch_results.jsonl";
+    string serveSocket;
+    int serveTcpPort = 0;
+    size_t cacheMb = 64;
+    size_t postingCacheMb = 256;
+    bool buildBiwords = false;
+    bool commonGrams = false;
+    int biwordMinDf = DEFAULT_BIWORD_MIN_DF;
+    string biwordListFile;
+    string biwordIndexFile = "pos_biword_index.bin";
+    bool buildOffsets = false;
+    bool showSnippets = false;
+    string offsetsFile = "pos_offsets.bin";
+    bool buildDocStore = false;
+    string docStoreFile = "pos_doc_store.bin";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--import" && i + 1 < argc) {
+            importJsonFile = argv[++i];
+        } else if (arg == "--import-docs" && i + 1 < argc) {
+            importDocsCsv = argv[++i];
+        } else if (arg == "--max-doc-id" && i + 1 < argc) {
+            importMaxDocId = max(0, atoi(argv[++i]));
+        } else if (arg == "--out" && i + 1 < argc) {
+            binaryIndexFile = argv[++i];
+        } else if (arg == "--doc-table" && i + 1 < argc) {
+            docTableFile = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = max(1, atoi(argv[++i]));
+        } else if (arg == "--in-flight" && i + 1 < argc) {
+            inFlight = (size_t)max(0, atoi(argv[++i]));
+        } else if (arg == "--shards" && i + 1 < argc) {
+            shards = (size_t)max(1, atoi(argv[++i]));
+        } else if (arg == "--top" && i + 1 < argc) {
+            topK = (size_t)max(0, atoi(argv[++i]));
+        } else if (arg == "--first" && i + 1 < argc) {
+            firstN = (size_t)max(0, atoi(argv[++i]));
+        } else if (arg == "--count") {
+            countOnly = true;
+        } else if (arg == "--explain") {
+            explain = true;
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchFile = argv[++i];
+        } else if (arg == "--batch-out" && i + 1 < argc) {
+            batchOutFile = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serveSocket = argv[++i];
+        } else if (arg == "--serve-tcp" && i + 1 < argc) {
+            serveTcpPort = atoi(argv[++i]);
+        } else if (arg == "--cache-mb" && i + 1 < argc) {
+            cacheMb = (size_t)max(0, atoi(argv[++i]));
+        } else if (arg == "--posting-cache-mb" && i + 1 < argc) {
+            postingCacheMb = (size_t)max(0, atoi(argv[++i]));
+        } else if (arg == "--biwords") {
+            buildBiwords = true;
+        } else if (arg == "--common-grams") {
+            commonGrams = true;
+        } else if (arg == "--offsets") {
+            buildOffsets = true;
+        } else if (arg == "--doc-store") {
+            buildDocStore = true;
+        } else if (arg == "--snippets") {
+            // THE INDEX IS REBUILT BEFORE THE QUERY, SO IT NEEDS ITS OFFSETS
+            buildOffsets = showSnippets = true;
+        } else if (arg == "--biword-min-df" && i + 1 < argc) {
+            biwordMinDf = max(1, atoi(argv[++i]));
+        } else if (arg == "--biword-list" && i + 1 < argc) {
+            biwordListFile = argv[++i];
+        } else {
+            cerr << "UNKNOWN ARGUMENT: " << arg << "\n";
+            cerr << "USAGE: main [--import <index.json> [--out <index.bin>] [--threads N] [--max-doc-id N]]\n";
+            cerr << "            [--import-docs <mapping.csv> [--doc-table <mapping.bin>]]\n";
+            cerr << "            [--top K | --first N | --count] [--explain] [--shards N]\n";
+            cerr << "            [--batch <queries.txt|.jsonl> [--batch-out <results.jsonl>]\n";
+            cerr << "            [--in-flight N] [--cache-mb N] [--posting-cache-mb N]]\n";
+            cerr << "            [--serve <socket> | --serve-tcp <port>] [--cache-mb N] [--posting-cache-mb N]\n";
+            cerr << "            [--biwords [--biword-min-df N] [--biword-list <phrases.txt>]] [--common-grams]\n";
+            cerr << "            [--offsets] [--doc-store] [--snippets]\n";
+            return 1;
+        }
+    }
+
+    // IMPORT MODE: CONVERT AN EXISTING JSON INDEX AND/OR DOC MAPPING TO THE BINARY FORMATS AND EXIT
+    if (!importJsonFile.empty() || !importDocsCsv.empty()) {
+        bool ok = true;
+        if (!importJsonFile.empty()) ok = importJsonIndex(importJsonFile, binaryIndexFile, numThreads, importMaxDocId) && ok;
+        if (!importDocsCsv.empty()) ok = importDocTableCsv(importDocsCsv, docTableFile) && ok;
+        return ok ? 0 : 1;
+    }
+
+    // BATCH MODE: REPLAY A QUERY FILE AGAINST THE EXISTING BINARY INDEX AND EXIT
+    if (!batchFile.empty()) {
+        IndexReader index, biwords;
+        DocTable docTable;
+        if (!index.open(binaryIndexFile) || !docTable.open(docTableFile)) return 1;
+        BatchOptions options;
+        if (openBiwordIndex(biwordIndexFile, index, biwords)) options.biwords = &biwords;
+        options.queriesFile = batchFile;
+        options.outFile = batchOutFile;
+        options.numThreads = numThreads;
+        options.inFlight = inFlight;
+        options.mode.topK = topK;
+        options.mode.firstN = firstN;
+        options.mode.countOnly = countOnly;
+        options.cacheBytes = cacheMb << 20;
+        options.postingCacheBytes = postingCacheMb << 20;
+        return runQueryBatch(index, docTable, options) ? 0 : 1;
+    }
+
+    // SERVER MODE: ANSWER QUERIES OVER A LOCAL SOCKET AGAINST THE EXISTING BINARY INDEX UNTIL STOPPED
+    if (!serveSocket.empty() || serveTcpPort != 0) {
+        IndexReader index, biwords;
+        DocTable docTable;
+        if (!index.open(binaryIndexFile) || !docTable.open(docTableFile)) return 1;
+        ServerOptions options;
+        if (openBiwordIndex(biwordIndexFile, index, biwords)) options.biwords = &biwords;
+        options.socketPath = serveSocket;
+        options.tcpPort = serveTcpPort;
+        options.numThreads = numThreads;
+        options.shards = shards;
+        options.mode.topK = topK;
+        options.mode.firstN = firstN;
+        options.mode.countOnly = countOnly;
+        options.cacheBytes = cacheMb << 20;
+        options.postingCacheBytes = postingCacheMb << 20;
+        return runQueryServer(index, docTable, options) ? 0 : 1;
+    }
+
     cout << "SPIMI POSITIONAL INVERTED INDEX - STARTING\n";
 
     // INDEX IN A SINGLE BLOCK (CURRENT BLOCK)
@@ -231,9 +419,21 @@ int main() {
     vector<string> blockFiles; // TRACK WRITTEN BLOCK FILES
     int blockCount = 0;
 
+    // OPTIONAL BIWORD BLOCKS: "stem stem" -> DOC -> POSITIONS OF THE FIRST STEM
+    map<string, map<int, vector<int>>> currentBiwords;
+    vector<string> biwordBlockFiles;
+
     // DOC ID TO PATH MAPPING
     map<int, string> docIdToPath;
     int docCounter = 1;
+    vector<uint32_t> docLengths(1, 0); // INDEXED TOKENS PER DOC ID, FOR BM25
+
+    // OPTIONAL BYTE OFFSETS OF EVERY POSITION, STREAMED OUT DOC BY DOC
+    DocOffsetsWriter offsetsWriter;
+    if (buildOffsets && !offsetsWriter.open(offsetsFile)) return 1;
+    // OPTIONAL COMPRESSED COPY OF EVERY DOC, SO RESULTS RENDER WITHOUT THE ORIGINAL FILES
+    DocStoreWriter docStoreWriter;
+    if (buildDocStore && !docStoreWriter.open(docStoreFile)) return 1;
 
     string folderPath = "./docs";
 
@@ -244,6 +444,7 @@ int main() {
 
         string path = entry.path().string();
         docIdToPath[docCounter] = path;
+        docLengths.push_back(0);
 
         ifstream inFile(path);
         if (!inFile.is_open()) {
@@ -258,11 +459,29 @@ int main() {
 
         // TOKENIZE WITH POSITIONS
         auto tokens = tokenizeWithPositions(content);
+        docLengths[docCounter] = (uint32_t)tokens.size();
         for (const auto &tp : tokens) {
             const string &term = tp.first;
             int pos = tp.second;
             currentBlock[term][docCounter].push_back(pos);
         }
+        if (buildOffsets) offsetsWriter.addDoc(docCounter, tokenByteSpans(content));
+        if (buildDocStore) docStoreWriter.addDoc(docCounter, content);
+        // GRAMS DO NOT COUNT TOWARDS THE DOC LENGTH
+        if (commonGrams) {
+            for (const auto &gram : commonGramTokens(content)) currentBlock[gram.first][docCounter].push_back(gram.second);
+        }
+        if (buildBiwords) {
+            for (size_t t = 1; t < tokens.size(); ++t) {
+                if (tokens[t].second != tokens[t - 1].second + 1) continue;  // A DROPPED WORD IN BETWEEN
+                currentBiwords[tokens[t - 1].first + " " + tokens[t].first][docCounter].push_back(tokens[t - 1].second);
+            }
+            if (currentBiwords.size() >= BLOCK_TERM_LIMIT) {
+                biwordBlockFiles.push_back("spimi_biword_block_" + to_string(biwordBlockFiles.size() + 1) + ".jsonl");
+                writeBlockToDisk(currentBiwords, (int)biwordBlockFiles.size(), "spimi_biword_block_");
+                currentBiwords.clear();
+            }
+        }
 
         // IF BLOCK TERM LIMIT REACHED -> FLUSH BLOCK
         if (currentBlock.size() >= BLOCK_TERM_LIMIT) {
@@ -283,6 +502,12 @@ int main() {
         currentBlock.clear();
     }
 
+    if (!currentBiwords.empty()) {
+        biwordBlockFiles.push_back("spimi_biword_block_" + to_string(biwordBlockFiles.size() + 1) + ".jsonl");
+        writeBlockToDisk(currentBiwords, (int)biwordBlockFiles.size(), "spimi_biword_block_");
+        currentBiwords.clear();
+    }
+
     cout << "ALL BLOCKS WRITTEN. NUMBER OF BLOCKS: " << blockFiles.size() << "\n";
 
     // MERGE BLOCKS
@@ -292,6 +517,40 @@ int main() {
     // WRITE FINAL INDEX FILE
     string finalIndexFile = "pos_inverted_index.json";
     writeFinalIndexToFile(mergedIndex, finalIndexFile);
+    uint64_t generation = newIndexGeneration();
+    writeBinaryIndex(mergedIndex, docLengths, binaryIndexFile, generation,
+                     commonGrams ? BINARY_INDEX_FLAG_COMMON_GRAMS : 0);
+    mergedIndex.clear();
+
+    // BIWORD INDEX: KEEP PAIRS IN AT LEAST biwordMinDf DOCS OR ON THE CONFIGURED LIST
+    if (buildBiwords) {
+        cout << "MERGING BIWORD BLOCKS\n";
+        auto biwordIndex = mergeBlocksToIndex(biwordBlockFiles);
+        set<string> keep;
+        if (!biwordListFile.empty()) keep = loadBiwordList(biwordListFile);
+        for (auto it = biwordIndex.begin(); it != biwordIndex.end();) {
+            if ((int)it->second.size() < biwordMinDf && !keep.count(it->first)) it = biwordIndex.erase(it);
+            else ++it;
+        }
+        cout << "BIWORDS KEPT: " << biwordIndex.size() << "\n";
+        writeBinaryIndex(biwordIndex, docLengths, biwordIndexFile, generation, BINARY_INDEX_FLAG_BIWORDS);
+    } else {
+        // A BIWORD INDEX FROM AN EARLIER BUILD WOULD NOT MATCH THIS ONE
+        error_code ec;
+        fs::remove(biwordIndexFile, ec);
+    }
+    if (buildOffsets) {
+        offsetsWriter.finish(generation);
+    } else {
+        error_code ec;
+        fs::remove(offsetsFile, ec);
+    }
+    if (buildDocStore) {
+        docStoreWriter.finish(generation);
+    } else {
+        error_code ec;
+        fs::remove(docStoreFile, ec);
+    }
 
     // WRITE DOCID -> PATH MAPPING CSV
     string csvFileName = "docId_filePath_mapping.csv";
@@ -302,39 +561,102 @@ int main() {
     }
     csvOut.close();
     cout << "DOCID TO FILEPATH MAPPING WRITTEN: " << csvFileName << "\n";
+    writeDocTable(docIdToPath, docTableFile);
 
     cout << "INDEXING COMPLETED \n";
 
-    // PHRASE QUERY
-    cout << "\nENTER A PHRASE TO SEARCH: ";
+    // PHRASE / BOOLEAN QUERY
+    cout << "\nENTER A PHRASE OR QUERY TO SEARCH: ";
     string queryLine;
     getline(cin, queryLine);
 
-    auto queryTokens = tokenizeWithPositions(queryLine);
-
-    if (queryTokens.empty()) {
+    string parseError;
+    auto query = parseQuery(queryLine, parseError, commonGrams);
+    if (!parseError.empty()) {
+        cout << "INVALID QUERY: " << parseError << "\n";
+        return 1;
+    }
+    if (!query) {
         cout << "NOTHING? IS THAT WHAT YOU ARE HOPING TO FIND.\n";
         return 0;
     }
+    bool isPhrase = query->type == QueryNodeType::TERM || query->type == QueryNodeType::PHRASE;
+
+    // QUERIES RUN AGAINST THE MEMORY-MAPPED BINARY INDEX
+    IndexReader index, biwords;
+    if (!index.open(binaryIndexFile)) return 1;
+    const IndexReader *biwordReader = openBiwordIndex(biwordIndexFile, index, biwords) ? &biwords : nullptr;
+
+    // THE COST-BASED PLAN THE QUERY WILL RUN WITH, FROM LEXICON STATISTICS ONLY
+    if (explain) cout << "\nQUERY PLAN:\n" << explainPlan(*planQuery(index, *query, biwordReader));
+
+    // COUNT ONLY: NO RESULT IS MATERIALIZED OR PRINTED
+    if (countOnly) {
+        cout << "\nMATCHING DOCUMENTS: " << countQueryMatches(index, *query, nullptr, biwordReader) << "\n";
+        cout << "SPIMI INDEX PROGRAM FINISHED\n";
+        return 0;
+    }
 
-    set<int> matchingDocs;
-    const string &firstWord = queryTokens[0].first;
-    auto it = mergedIndex.find(firstWord);
-    if (it != mergedIndex.end()) {
-        for (const auto &docPair : it->second) {
-            int docId = docPair.first;
-            if (phraseExistsInDoc(queryTokens, mergedIndex, docId)) {
-                matchingDocs.insert(docId);
+    // RESULT PATHS COME FROM THE MEMORY-MAPPED DOC TABLE (O(1) LOOKUP PER RESULT)
+    DocTable docTable;
+    if (!docTable.open(docTableFile)) return 1;
+
+    // SNIPPETS: SEEK INTO EACH RESULT (IN THE DOC STORE IF BUILT, ELSE ITS FILE) THROUGH THE BYTE
+    // OFFSETS OF ITS MATCHING POSITIONS
+    DocOffsets offsets;
+    DocStore docStore;
+    unique_ptr<SnippetBuilder> snippets;
+    if (showSnippets && openDocOffsets(offsetsFile, index, offsets)) {
+        const DocStore *store = openDocStore(docStoreFile, index, docStore) ? &docStore : nullptr;
+        snippets = make_unique<SnippetBuilder>(index, offsets, positiveTermIds(index, *query), store);
+    }
+    auto printSnippet = [&](int docId) {
+        if (!snippets) return;
+        string text = snippets->build(docId, docTable.path(docId));
+        if (!text.empty()) cout << "    " << text << "\n";
+    };
+
+    if (topK > 0) {
+        // RANKED: BEST topK MATCHES BY BM25
+        RankStats stats;
+        vector<ScoredDoc> ranked = executeRankedQuery(index, *query, topK, stats, nullptr, biwordReader);
+        if (ranked.empty()) {
+            cout << (isPhrase ? "NO DOCUMENT FOUND FOR THIS PHRASE.\n" : "NO DOCUMENT FOUND FOR THIS QUERY.\n");
+        } else {
+            cout << "\nTOP " << ranked.size() << " RESULTS (BM25):\n";
+            for (const ScoredDoc &r : ranked) {
+                cout << "- " << docTable.path(r.docId) << " (" << r.score << ")\n";
+                printSnippet(r.docId);
             }
         }
+        cout << "SCORED " << stats.docsScored << " DOCS, DECODED " << stats.blocksDecoded << " OF "
+             << stats.blocksTotal << " POSTING BLOCKS\n";
+        cout << "SPIMI INDEX PROGRAM FINISHED\n";
+        return 0;
     }
 
+    // --first N STOPS THE QUERY AT ITS N-TH MATCH; --shards N SPLITS A FULL ONE OVER N - 1 HELPER THREADS
+    // AND THIS ONE
+    vector<int> matchingDocs;
+    if (firstN > 0) {
+        matchingDocs = executeQueryFirst(index, *query, firstN, nullptr, biwordReader);
+    } else if (shards > 1) {
+        ThreadPool pool(shards - 1);
+        ShardOptions sharding;
+        sharding.pool = &pool;
+        sharding.shards = shards;
+        matchingDocs = executeQuerySharded(index, *query, sharding, nullptr, biwordReader);
+    } else {
+        matchingDocs = executeQuery(index, *query, nullptr, biwordReader);
+    }
     if (matchingDocs.empty()) {
-        cout << "NO DOCUMENT FOUND FOR THIS PHRASE.\n";
+        cout << (isPhrase ? "NO DOCUMENT FOUND FOR THIS PHRASE.\n" : "NO DOCUMENT FOUND FOR THIS QUERY.\n");
     } else {
-        cout << "\nPHRASE LOCATED IN:\n";
+        cout << (isPhrase ? "\nPHRASE LOCATED IN:\n" : "\nQUERY MATCHED IN:\n");
+        if (firstN > 0) cout << "(FIRST " << matchingDocs.size() << " MATCHES)\n";
         for (int id : matchingDocs) {
-            cout << "- " << docIdToPath[id] << "\n";
+            cout << "- " << docTable.path(id) << "\n";
+            printSnippet(id);
         }
     }
 
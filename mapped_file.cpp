@@ -0,0 +1,140 @@
+#include "mapped_file.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const string &path) {
+    close();
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        cerr << "ERROR OPENING FILE FOR MAPPING: " << path << endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    size_ = (size_t)fileSize.QuadPart;
+    fileHandle_ = file;
+    opened_ = true;
+    if (size_ == 0) return true;
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr) {
+        cerr << "ERROR MAPPING FILE: " << path << endl;
+        close();
+        return false;
+    }
+    mappingHandle_ = mapping;
+    data_ = static_cast<const char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cerr << "ERROR OPENING FILE FOR MAPPING: " << path << endl;
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        cerr << "ERROR READING FILE SIZE: " << path << endl;
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    opened_ = true;
+    if (size_ == 0) {
+        ::close(fd);
+        return true;
+    }
+
+    void *addr = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr != MAP_FAILED) data_ = static_cast<const char *>(addr);
+#endif
+    if (data_ == nullptr) {
+        cerr << "ERROR MAPPING FILE: " << path << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (data_ != nullptr) UnmapViewOfFile(data_);
+    if (mappingHandle_ != nullptr) CloseHandle(static_cast<HANDLE>(mappingHandle_));
+    if (fileHandle_ != nullptr) CloseHandle(static_cast<HANDLE>(fileHandle_));
+    mappingHandle_ = nullptr;
+    fileHandle_ = nullptr;
+#else
+    if (data_ != nullptr) munmap(const_cast<char *>(data_), size_);
+#endif
+    data_ = nullptr;
+    size_ = 0;
+    opened_ = false;
+}
+
+#ifndef _WIN32
+namespace {
+
+// [offset, offset + length) WIDENED TO WHOLE PAGES; FALSE IF IT IS EMPTY OR OUTSIDE THE MAPPING
+bool pageRange(const char *data, size_t size, size_t offset, size_t length, char *&begin, size_t &bytes) {
+    if (data == nullptr || length == 0 || offset >= size) return false;
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    size_t first = offset / pageSize * pageSize;
+    size_t end = min(size, offset + length);
+    begin = const_cast<char *>(data) + first;
+    bytes = end - first;
+    return true;
+}
+
+} // namespace
+#endif
+
+void MappedFile::prefetch(size_t offset, size_t length) const {
+#ifndef _WIN32
+    char *begin;
+    size_t bytes;
+    if (pageRange(data_, size_, offset, length, begin, bytes)) madvise(begin, bytes, MADV_WILLNEED);
+#else
+    (void)offset;
+    (void)length;
+#endif
+}
+
+bool MappedFile::resident(size_t offset, size_t length) const {
+#ifndef _WIN32
+    char *begin;
+    size_t bytes;
+    if (!pageRange(data_, size_, offset, length, begin, bytes)) return true;
+    static const size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    vector<unsigned char> pages((bytes + pageSize - 1) / pageSize);
+#ifdef __APPLE__
+    if (mincore(begin, bytes, reinterpret_cast<char *>(pages.data())) != 0) return true;
+#else
+    if (mincore(begin, bytes, pages.data()) != 0) return true;
+#endif
+    for (unsigned char page : pages) {
+        if (!(page & 1)) return false;
+    }
+#else
+    (void)offset;
+    (void)length;
+#endif
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef _MAPPED_FILE_H_
+#define _MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+// READ-ONLY MEMORY-MAPPED FILE (POSIX mmap / WIN32 MapViewOfFile)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // MAP THE WHOLE FILE; RETURNS FALSE (AND PRINTS AN ERROR) ON FAILURE
+    bool open(const std::string &path);
+    void close();
+
+    bool isOpen() const { return opened_; }
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+
+    // ASK THE OS TO START READING [offset, offset + length) IN THE BACKGROUND (madvise WILLNEED);
+    // RETURNS AT ONCE. A NO-OP WHERE THIS IS NOT SUPPORTED
+    void prefetch(size_t offset, size_t length) const;
+    // TRUE IF EVERY PAGE OF [offset, offset + length) IS IN MEMORY (mincore), SO READING IT DOES NOT
+    // WAIT FOR THE DISK. ALWAYS TRUE WHERE THIS CANNOT BE ASKED
+    bool resident(size_t offset, size_t length) const;
+
+private:
+    const char *data_ = nullptr;
+    size_t size_ = 0;
+    bool opened_ = false;
+#ifdef _WIN32
+    void *fileHandle_ = nullptr;
+    void *mappingHandle_ = nullptr;
+#endif
+};
+
+#endif
@@ -0,0 +1,96 @@
+#include "posting_cache.h"
+#include <algorithm>
+
+using namespace std;
+
+// ROUGH PER-ENTRY OVERHEAD OF THE LIST NODE, HASH NODE AND VECTOR HEADERS
+static const size_t POSTING_CACHE_ENTRY_OVERHEAD = 160;
+
+static size_t postingListBytes(const PostingList &postings) {
+    return (postings.docIds.capacity() + postings.posStarts.capacity() + postings.positions.capacity()) *
+               sizeof(int) + POSTING_CACHE_ENTRY_OVERHEAD;
+}
+
+PostingCache::PostingCache(size_t capacityBytes)
+    : capacityBytes_(capacityBytes), sketch_(1 << 16) {}
+
+void PostingCache::checkGeneration(uint64_t generation) {
+    if (generation == generation_) return;
+    lru_.clear();
+    map_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+    generation_ = generation;
+}
+
+shared_ptr<const PostingList> PostingCache::fetch(const IndexReader &index, int termId, bool withPositions) {
+    bool candidate = index.entry(termId).df >= POSTING_CACHE_MIN_DF;
+    if (candidate) {
+        lock_guard<mutex> lock(mutex_);
+        checkGeneration(index.generation());
+        sketch_.increment((uint64_t)termId);
+        auto it = map_.find(termId);
+        if (it != map_.end() && (it->second->withPositions || !withPositions)) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            stats_.hits++;
+            return it->second->postings;
+        }
+        stats_.misses++;
+    }
+
+    // DECODE OUTSIDE THE LOCK
+    auto postings = make_shared<PostingList>();
+    index.decodePostings(termId, *postings, withPositions);
+    if (candidate) {
+        lock_guard<mutex> lock(mutex_);
+        if (index.generation() == generation_) admit(termId, postings, withPositions);
+    }
+    return postings;
+}
+
+void PostingCache::admit(int termId, const shared_ptr<const PostingList> &postings, bool withPositions) {
+    uint32_t frequency = sketch_.estimate((uint64_t)termId);
+    if (frequency < POSTING_CACHE_MIN_REQUESTS) return;
+    size_t bytes = postingListBytes(*postings);
+    if (bytes > capacityBytes_) return;
+
+    auto existing = map_.find(termId);
+    // ANOTHER THREAD CACHED IT MEANWHILE, OR WE ARE UPGRADING A DOC-ID-ONLY LIST, WHOSE BYTES THEN COUNT AS FREE
+    if (existing != map_.end() && (existing->second->withPositions || !withPositions)) return;
+    size_t freed = existing != map_.end() ? existing->second->bytes : 0;
+
+    // PICK THE VICTIMS FROM THE LRU END FIRST; NOTHING IS EVICTED OR REPLACED UNLESS THE LIST WINS AGAINST
+    // ALL OF THEM, SO A LOST UPGRADE KEEPS THE DOC-ID-ONLY ENTRY
+    size_t victims = 0;
+    for (auto victim = lru_.rbegin(); stats_.bytes - freed + bytes > capacityBytes_; ++victim) {
+        if (victim->termId == termId) continue;
+        if (frequency <= sketch_.estimate((uint64_t)victim->termId)) return;
+        freed += victim->bytes;
+        ++victims;
+    }
+
+    if (existing != map_.end()) {
+        stats_.bytes -= existing->second->bytes;
+        stats_.entries--;
+        lru_.erase(existing->second);
+        map_.erase(existing);
+    }
+    for (; victims > 0; --victims) {
+        stats_.bytes -= lru_.back().bytes;
+        map_.erase(lru_.back().termId);
+        lru_.pop_back();
+        stats_.entries--;
+        stats_.evictions++;
+    }
+
+    lru_.push_front({termId, postings, withPositions, bytes});
+    map_[termId] = lru_.begin();
+    stats_.entries++;
+    stats_.bytes += bytes;
+    stats_.inserts++;
+}
+
+PostingCacheStats PostingCache::stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
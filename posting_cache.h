@@ -0,0 +1,64 @@
+#ifndef _POSTING_CACHE_H_
+#define _POSTING_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "binary_index.h"
+#include "frequency_sketch.h"
+
+// TERMS WITH FEWER DOCS ARE CHEAP TO DECODE AND NEVER CACHED
+static const uint32_t POSTING_CACHE_MIN_DF = 256;
+
+// A TERM MUST HAVE BEEN REQUESTED THIS OFTEN (PER THE FREQUENCY SKETCH) BEFORE IT IS CACHED
+static const uint32_t POSTING_CACHE_MIN_REQUESTS = 2;
+
+struct PostingCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    double hitRate() const { return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+};
+
+// DECODED POSTING LISTS OF HOT TERMS, SHARED ACROSS QUERY THREADS AND BOUNDED BY A BYTE BUDGET.
+// ONLY FREQUENT TERMS (df >= POSTING_CACHE_MIN_DF) THAT KEEP BEING QUERIED ARE ADMITTED; WHEN FULL,
+// THE LRU ENTRY IS ONLY EVICTED FOR A TERM REQUESTED MORE OFTEN (TINYLFU). LISTS ARE HANDED OUT
+// AS shared_ptr, SO AN EVICTED LIST STAYS VALID FOR QUERIES STILL USING IT
+class PostingCache {
+public:
+    explicit PostingCache(size_t capacityBytes);
+
+    // DECODED POSTINGS OF termId, FROM THE CACHE OR FRESHLY DECODED. A LIST DECODED WITH
+    // POSITIONS ALSO SERVES DOC-ID-ONLY REQUESTS
+    std::shared_ptr<const PostingList> fetch(const IndexReader &index, int termId, bool withPositions);
+    PostingCacheStats stats() const;
+
+private:
+    struct Entry {
+        int termId;
+        std::shared_ptr<const PostingList> postings;
+        bool withPositions;
+        size_t bytes;
+    };
+
+    // CALLERS HOLD mutex_
+    void checkGeneration(uint64_t generation);
+    void admit(int termId, const std::shared_ptr<const PostingList> &postings, bool withPositions);
+
+    size_t capacityBytes_;
+    uint64_t generation_ = 0;
+    std::list<Entry> lru_;  // MOST RECENTLY USED FIRST
+    std::unordered_map<int, std::list<Entry>::iterator> map_;
+    FrequencySketch sketch_;
+    PostingCacheStats stats_;
+    mutable std::mutex mutex_;
+};
+
+#endif
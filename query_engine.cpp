@@ -0,0 +1,635 @@
+#include "query_engine.h"
+#include "fuzzy.h"
+#include "intersect.h"
+#include "query_planner.h"
+#include "wildcard.h"
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <memory>
+
+using namespace std;
+
+void PostingIterator::advance(int target) {
+    index_ = gallopLowerBound(postings_->docIds.data(), postings_->size(), index_, target);
+}
+
+bool phraseExistsInDoc(const vector<PostingIterator> &terms, const vector<int> &offsets, PhraseScratch &scratch) {
+    if (terms.empty()) return false;
+
+    // ORDER TERMS BY IN-DOC POSITION COUNT (INSERTION SORT: QUERIES ARE SHORT)
+    auto &order = scratch.order;
+    order.clear();
+    for (size_t i = 0; i < terms.size(); ++i) {
+        size_t k = order.size();
+        order.push_back(i);
+        while (k > 0 && terms[order[k - 1]].positionCount() > terms[i].positionCount()) {
+            order[k] = order[k - 1];
+            --k;
+        }
+        order[k] = i;
+    }
+
+    // ANCHOR: CANDIDATE PHRASE STARTS FROM THE RAREST TERM
+    const PostingIterator &anchor = terms[order[0]];
+    int anchorOffset = offsets[order[0]];
+    auto &candidates = scratch.candidates;
+    candidates.resize(anchor.positionCount());
+    for (size_t k = 0; k < candidates.size(); ++k) candidates[k] = anchor.positions()[k] - anchorOffset;
+
+    // EACH OTHER TERM MUST OCCUR AT start + offset
+    for (size_t k = 1; k < order.size(); ++k) {
+        const PostingIterator &term = terms[order[k]];
+        size_t kept = intersectShifted(candidates.data(), candidates.size(),
+                                       term.positions(), term.positionCount(), offsets[order[k]], candidates.data());
+        if (kept == 0) return false;
+        candidates.resize(kept);
+    }
+    return !candidates.empty();
+}
+
+bool sloppyPhraseExistsInDoc(const vector<PostingIterator> &terms, const vector<int> &offsets, int slop,
+                             PhraseScratch &scratch) {
+    if (terms.empty()) return false;
+    auto &cursors = scratch.cursors;
+    cursors.assign(terms.size(), 0);
+    int querySpan = offsets.back() - offsets.front();
+
+    const int *first = terms[0].positions();
+    for (size_t k = 0; k < terms[0].positionCount(); ++k) {
+        int prev = first[k];
+        for (size_t i = 1; i < terms.size(); ++i) {
+            cursors[i] = gallopLowerBound(terms[i].positions(), terms[i].positionCount(), cursors[i], prev + 1);
+            // THIS TERM HAS NO OCCURRENCE AFTER prev, AND LATER STARTS ONLY MAKE prev LARGER
+            if (cursors[i] == terms[i].positionCount()) return false;
+            prev = terms[i].positions()[cursors[i]];
+        }
+        if (prev - first[k] - querySpan <= slop) return true;
+    }
+    return false;
+}
+
+bool termsNearInDoc(const vector<PostingIterator> &terms, int maxGap, PhraseScratch &scratch) {
+    if (terms.empty()) return false;
+    auto &cursors = scratch.cursors;
+    cursors.assign(terms.size(), 0);
+    int extraWords = (int)terms.size() - 1;
+
+    while (true) {
+        size_t minTerm = 0;
+        int minPos = INT_MAX, maxPos = INT_MIN;
+        for (size_t i = 0; i < terms.size(); ++i) {
+            int p = terms[i].positions()[cursors[i]];
+            if (p < minPos) {
+                minPos = p;
+                minTerm = i;
+            }
+            maxPos = max(maxPos, p);
+        }
+        if (maxPos - minPos - extraWords <= maxGap) return true;
+        if (++cursors[minTerm] == terms[minTerm].positionCount()) return false;
+    }
+}
+
+const PostingList *QueryContext::postings(const string &term, bool withPositions) {
+    Decoded &slot = decoded_[term];
+    if (slot.full) return slot.full.get();
+    if (slot.docsOnly && !withPositions) return slot.docsOnly.get();
+
+    int termId = index_.findTerm(term);
+    if (termId < 0) return nullptr;
+    shared_ptr<const PostingList> postings;
+    if (!range_.whole()) {
+        auto decoded = make_shared<PostingList>();
+        index_.decodePostingsRange(termId, range_.first, range_.last, *decoded, withPositions);
+        postings = move(decoded);
+    } else if (cache_) {
+        postings = cache_->fetch(index_, termId, withPositions);
+    } else {
+        auto decoded = make_shared<PostingList>();
+        index_.decodePostings(termId, *decoded, withPositions);
+        postings = move(decoded);
+    }
+    (withPositions ? slot.full : slot.docsOnly) = postings;
+    return postings.get();
+}
+
+const PostingList *QueryContext::biwordPostings(const string &first, const string &second) {
+    if (!biwords_) return nullptr;
+    string key = first + " " + second;
+    Decoded &slot = decoded_[key];
+    if (!slot.full) {
+        int termId = biwords_->findTerm(key);
+        if (termId < 0) return nullptr;
+        auto decoded = make_shared<PostingList>();
+        biwords_->decodePostingsRange(termId, range_.first, range_.last, *decoded);
+        slot.full = move(decoded);
+    }
+    return slot.full.get();
+}
+
+const PostingList *QueryContext::expansionPostings(const string &key, const vector<int> &termIds) {
+    Decoded &slot = decoded_[key];
+    if (!slot.docsOnly) {
+        // ONE BIT PER DOC: EACH EXPANDED LIST IS WALKED ONCE, THEN THE SET BITS COME OUT IN DOC ORDER
+        vector<uint64_t> bits((size_t)index_.maxDocId() / 64 + 1, 0);
+        for (int termId : termIds) {
+            BlockCursor cursor(index_, termId);
+            for (cursor.advance(range_.first); cursor.doc() <= range_.last && cursor.doc() != END_DOC; cursor.next()) {
+                bits[(size_t)cursor.doc() / 64] |= uint64_t(1) << (cursor.doc() % 64);
+            }
+        }
+        auto merged = make_shared<PostingList>();
+        for (size_t w = 0; w < bits.size(); ++w) {
+            int bit = 0;
+            for (uint64_t word = bits[w]; word != 0; word >>= 1, ++bit) {
+                if (word & 1) merged->docIds.push_back((int)(w * 64) + bit);
+            }
+        }
+        merged->posStarts.assign(merged->docIds.size() + 1, 0);
+        slot.docsOnly = move(merged);
+    }
+    return slot.docsOnly.get();
+}
+
+shared_ptr<const RoaringBitmap> QueryContext::docSet(int termId) {
+    Decoded &slot = decoded_[string(index_.term(termId))];
+    if (!slot.docSet && index_.hasDocSet(termId)) {
+        auto loaded = make_shared<RoaringBitmap>();
+        if (index_.loadDocSet(termId, *loaded)) slot.docSet = move(loaded);
+    }
+    return slot.docSet;
+}
+
+namespace {
+
+class EmptyIterator : public DocIterator {
+public:
+    int doc() const override { return END_DOC; }
+    void next() override {}
+    void advance(int) override {}
+    size_t cost() const override { return 0; }
+};
+
+// LAZY CURSOR OVER A TERM'S ON-DISK BLOCKS: ONLY THE BLOCKS IT IS ADVANCED INTO ARE DECODED. THE
+// PLANNER PICKS IT FOR A FREQUENT TERM THAT A RARER ONE DRIVES
+class SkipCursorIterator : public DocIterator {
+public:
+    SkipCursorIterator(const IndexReader &index, int termId) : cursor_(index, termId) {}
+    int doc() const override { return cursor_.doc(); }
+    void next() override { cursor_.next(); }
+    void advance(int target) override { cursor_.advance(target); }
+    size_t cost() const override { return cursor_.df(); }
+
+private:
+    BlockCursor cursor_;
+};
+
+class DocSetIterator : public DocIterator {
+public:
+    explicit DocSetIterator(shared_ptr<const RoaringBitmap> set) : set_(move(set)), cursor_(*set_) {}
+    int doc() const override { return cursor_.doc(); }
+    void next() override { cursor_.next(); }
+    void advance(int target) override { cursor_.advance(target); }
+    size_t cost() const override { return set_->cardinality(); }
+
+private:
+    shared_ptr<const RoaringBitmap> set_;
+    RoaringBitmap::Cursor cursor_;
+};
+
+// DOC IDS COMPUTED WHILE BUILDING THE TREE (A TERM LIST FILTERED THROUGH A DOC SET)
+class DocListIterator : public DocIterator {
+public:
+    explicit DocListIterator(vector<int> docs) : docs_(move(docs)) {}
+    int doc() const override { return index_ < docs_.size() ? docs_[index_] : END_DOC; }
+    void next() override { ++index_; }
+    void advance(int target) override { index_ = gallopLowerBound(docs_.data(), docs_.size(), index_, target); }
+    size_t cost() const override { return docs_.size(); }
+
+private:
+    vector<int> docs_;
+    size_t index_ = 0;
+};
+
+// EVERY DOC ID 1..maxDocId (BASE SET FOR PURELY NEGATIVE QUERIES)
+class AllDocsIterator : public DocIterator {
+public:
+    explicit AllDocsIterator(int maxDocId) : maxDocId_(maxDocId), doc_(maxDocId >= 1 ? 1 : END_DOC) {}
+    int doc() const override { return doc_; }
+    void next() override { doc_ = doc_ < maxDocId_ ? doc_ + 1 : END_DOC; }
+    void advance(int target) override {
+        if (target > doc_) doc_ = target <= maxDocId_ ? target : END_DOC;
+    }
+    size_t cost() const override { return (size_t)max(maxDocId_, 0); }
+
+private:
+    int maxDocId_;
+    int doc_;
+};
+
+class TermIterator : public DocIterator {
+public:
+    explicit TermIterator(const PostingList *postings) : it_(postings) {}
+    int doc() const override { return it_.doc(); }
+    void next() override { it_.next(); }
+    void advance(int target) override { it_.advance(target); }
+    size_t cost() const override { return it_.cost(); }
+
+private:
+    PostingIterator it_;
+};
+
+// DOCS CONTAINING EVERY TERM (RAREST DRIVING) WHOSE POSITIONS PASS THE match CHECK
+class PhraseIterator : public DocIterator {
+public:
+    PhraseIterator(vector<PostingIterator> terms, vector<int> offsets, PositionMatch match = PositionMatch::EXACT,
+                   int slop = 0)
+        : terms_(move(terms)), offsets_(move(offsets)), order_(terms_.size()), match_(match), slop_(slop) {
+        for (size_t i = 0; i < order_.size(); ++i) order_[i] = i;
+        stable_sort(order_.begin(), order_.end(),
+                    [&](size_t a, size_t b) { return terms_[a].cost() < terms_[b].cost(); });
+        findMatch();
+    }
+
+    int doc() const override { return doc_; }
+    void next() override {
+        if (doc_ == END_DOC) return;
+        lead().next();
+        findMatch();
+    }
+    void advance(int target) override {
+        if (target <= doc_) return;
+        lead().advance(target);
+        findMatch();
+    }
+    size_t cost() const override { return terms_[order_[0]].cost(); }
+
+private:
+    PostingIterator &lead() { return terms_[order_[0]]; }
+
+    // FROM THE LEAD'S CURRENT DOC, FIND THE NEXT DOC CONTAINING ALL TERMS THAT VERIFIES
+    void findMatch() {
+        int doc = lead().doc();
+        while (doc != END_DOC) {
+            bool allMatch = true;
+            for (size_t k = 1; k < order_.size(); ++k) {
+                PostingIterator &it = terms_[order_[k]];
+                it.advance(doc);
+                if (it.doc() != doc) {
+                    lead().advance(it.doc());
+                    doc = lead().doc();
+                    allMatch = false;
+                    break;
+                }
+            }
+            if (!allMatch) continue;
+            if (positionsMatch()) break;
+            lead().next();
+            doc = lead().doc();
+        }
+        doc_ = doc;
+    }
+
+    bool positionsMatch() {
+        switch (match_) {
+            case PositionMatch::EXACT: return phraseExistsInDoc(terms_, offsets_, scratch_);
+            case PositionMatch::SLOPPY: return sloppyPhraseExistsInDoc(terms_, offsets_, slop_, scratch_);
+            case PositionMatch::NEAR: return termsNearInDoc(terms_, slop_, scratch_);
+        }
+        return false;
+    }
+
+    vector<PostingIterator> terms_;
+    vector<int> offsets_;
+    vector<size_t> order_;
+    PositionMatch match_;
+    int slop_;
+    PhraseScratch scratch_;
+    int doc_ = END_DOC;
+};
+
+// LEAPFROG: THE CHEAPEST CHILD PROPOSES, THE OTHERS advance() TO IT OR OVERSHOOT AND RE-PROPOSE
+class ConjunctionIterator : public DocIterator {
+public:
+    explicit ConjunctionIterator(vector<unique_ptr<DocIterator>> children) : children_(move(children)) {
+        stable_sort(children_.begin(), children_.end(),
+                    [](const unique_ptr<DocIterator> &a, const unique_ptr<DocIterator> &b) { return a->cost() < b->cost(); });
+        align(children_[0]->doc());
+    }
+
+    int doc() const override { return doc_; }
+    void next() override {
+        if (doc_ != END_DOC) align(doc_ + 1);
+    }
+    void advance(int target) override {
+        if (target > doc_) align(target);
+    }
+    size_t cost() const override { return children_[0]->cost(); }
+
+private:
+    void align(int target) {
+        int doc = target;
+        while (true) {
+            children_[0]->advance(doc);
+            doc = children_[0]->doc();
+            if (doc == END_DOC) break;
+            bool allMatch = true;
+            for (size_t k = 1; k < children_.size(); ++k) {
+                children_[k]->advance(doc);
+                if (children_[k]->doc() != doc) {
+                    doc = children_[k]->doc();
+                    allMatch = false;
+                    break;
+                }
+            }
+            if (allMatch || doc == END_DOC) break;
+        }
+        doc_ = doc;
+    }
+
+    vector<unique_ptr<DocIterator>> children_;
+    int doc_ = END_DOC;
+};
+
+// UNION: CHILDREN IN A MIN-HEAP KEYED BY THEIR CURRENT DOC
+class DisjunctionIterator : public DocIterator {
+public:
+    explicit DisjunctionIterator(vector<unique_ptr<DocIterator>> children) : children_(move(children)) {
+        for (auto &child : children_) {
+            cost_ += child->cost();
+            if (child->doc() != END_DOC) heap_.push_back(child.get());
+        }
+        make_heap(heap_.begin(), heap_.end(), laterDoc);
+    }
+
+    int doc() const override { return heap_.empty() ? END_DOC : heap_.front()->doc(); }
+    void next() override {
+        if (!heap_.empty()) advance(doc() + 1);
+    }
+    void advance(int target) override {
+        while (!heap_.empty() && heap_.front()->doc() < target) {
+            pop_heap(heap_.begin(), heap_.end(), laterDoc);
+            DocIterator *child = heap_.back();
+            child->advance(target);
+            if (child->doc() == END_DOC) {
+                heap_.pop_back();
+            } else {
+                push_heap(heap_.begin(), heap_.end(), laterDoc);
+            }
+        }
+    }
+    size_t cost() const override { return cost_; }
+
+private:
+    static bool laterDoc(const DocIterator *a, const DocIterator *b) { return a->doc() > b->doc(); }
+
+    vector<unique_ptr<DocIterator>> children_;
+    vector<DocIterator *> heap_;
+    size_t cost_ = 0;
+};
+
+// include MINUS exclude: exclude IS ONLY EVER ADVANCED TO include'S CANDIDATES
+class ExclusionIterator : public DocIterator {
+public:
+    ExclusionIterator(unique_ptr<DocIterator> include, unique_ptr<DocIterator> exclude)
+        : include_(move(include)), exclude_(move(exclude)) {
+        skipExcluded();
+    }
+
+    int doc() const override { return include_->doc(); }
+    void next() override {
+        include_->next();
+        skipExcluded();
+    }
+    void advance(int target) override {
+        if (target <= include_->doc()) return;
+        include_->advance(target);
+        skipExcluded();
+    }
+    size_t cost() const override { return include_->cost(); }
+
+private:
+    void skipExcluded() {
+        while (include_->doc() != END_DOC) {
+            exclude_->advance(include_->doc());
+            if (exclude_->doc() != include_->doc()) break;
+            include_->next();
+        }
+    }
+
+    unique_ptr<DocIterator> include_;
+    unique_ptr<DocIterator> exclude_;
+};
+
+unique_ptr<DocIterator> combineAll(vector<unique_ptr<DocIterator>> children, bool conjunction) {
+    if (children.size() == 1) return move(children[0]);
+    if (conjunction) return make_unique<ConjunctionIterator>(move(children));
+    return make_unique<DisjunctionIterator>(move(children));
+}
+
+// EXACT PHRASE OVER BIWORD LISTS: ADJACENT PAIRS ARE COVERED GREEDILY FROM THE LEFT BY BIWORDS; A
+// TOKEN LEFT OVER TAKES THE PAIR ENDING AT IT IF THAT EXISTS (OVERLAPS ARE JUST EXTRA CONSTRAINTS),
+// OTHERWISE ITS OWN POSTINGS. A TWO-WORD PHRASE BECOMES A PLAIN BIWORD CURSOR
+unique_ptr<DocIterator> buildBiwordPhrase(const QueryNode &node, QueryContext &ctx) {
+    const auto &tokens = node.tokens;
+    auto adjacent = [&](size_t i) { return tokens[i + 1].second == tokens[i].second + 1; };
+    vector<const PostingList *> lists;
+    vector<int> offsets;
+    size_t i = 0;
+    while (i < tokens.size()) {
+        const PostingList *postings = nullptr;
+        size_t start = i;
+        if (i + 1 < tokens.size() && adjacent(i)) postings = ctx.biwordPostings(tokens[i].first, tokens[i + 1].first);
+        if (postings) {
+            i += 2;
+        } else {
+            if (i > 0 && adjacent(i - 1)) postings = ctx.biwordPostings(tokens[i - 1].first, tokens[i].first);
+            if (postings) start = i - 1;
+            else postings = ctx.postings(tokens[i].first);
+            if (!postings) return make_unique<EmptyIterator>();
+            i += 1;
+        }
+        lists.push_back(postings);
+        offsets.push_back(tokens[start].second - tokens[0].second);
+    }
+    if (lists.size() == 1) return make_unique<TermIterator>(lists[0]);
+    vector<PostingIterator> terms(lists.begin(), lists.end());
+    return make_unique<PhraseIterator>(move(terms), move(offsets), PositionMatch::EXACT, 0);
+}
+
+// DISJUNCTION OF THE TERMS A WILDCARD / FUZZY TERM EXPANDED TO: A HEAP OF CURSORS FOR A FEW, ONE
+// UNIONED LIST (CACHED IN THE CONTEXT UNDER key) FOR MANY
+unique_ptr<DocIterator> buildExpansion(const string &key, const TermExpansion &expansion, QueryContext &ctx) {
+    if (expansion.termIds.empty()) return make_unique<EmptyIterator>();
+    if (expansion.termIds.size() > HEAP_UNION_MAX_TERMS) {
+        return make_unique<TermIterator>(ctx.expansionPostings(key, expansion.termIds));
+    }
+    vector<unique_ptr<DocIterator>> children;
+    for (int termId : expansion.termIds) {
+        children.push_back(make_unique<TermIterator>(ctx.postings(string(ctx.index().term(termId)), false)));
+    }
+    return combineAll(move(children), false);
+}
+
+unique_ptr<DocIterator> buildPlanned(const QueryPlan &plan, QueryContext &ctx) {
+    const QueryNode &node = *plan.node;
+    switch (plan.strategy) {
+        case PlanStrategy::EMPTY:
+            return make_unique<EmptyIterator>();
+        case PlanStrategy::DECODE: {
+            const PostingList *postings = ctx.postings(node.tokens[0].first, false);
+            if (!postings) return make_unique<EmptyIterator>();
+            return make_unique<TermIterator>(postings);
+        }
+        case PlanStrategy::SKIP_CURSOR:
+            return make_unique<SkipCursorIterator>(ctx.index(), plan.termId);
+        case PlanStrategy::DOC_SET: {
+            shared_ptr<const RoaringBitmap> set = ctx.docSet(plan.termId);
+            if (set) return make_unique<DocSetIterator>(move(set));
+            const PostingList *postings = ctx.postings(node.tokens[0].first, false);
+            if (!postings) return make_unique<EmptyIterator>();
+            return make_unique<TermIterator>(postings);
+        }
+        case PlanStrategy::BIWORD:
+            return buildBiwordPhrase(node, ctx);
+        case PlanStrategy::POSITIONAL: {
+            vector<PostingIterator> terms;
+            vector<int> offsets;
+            for (const auto &token : node.tokens) {
+                const PostingList *postings = ctx.postings(token.first);
+                if (!postings) return make_unique<EmptyIterator>();
+                terms.emplace_back(postings);
+                offsets.push_back(token.second - node.tokens[0].second);
+            }
+            PositionMatch match = node.type == QueryNodeType::NEAR ? PositionMatch::NEAR
+                                  : node.slop > 0 ? PositionMatch::SLOPPY
+                                  : PositionMatch::EXACT;
+            return make_unique<PhraseIterator>(move(terms), move(offsets), match, node.slop);
+        }
+        case PlanStrategy::HEAP_UNION:
+        case PlanStrategy::BITMAP_UNION:
+            return buildExpansion(describeQuery(node), plan.expansion, ctx);
+        case PlanStrategy::LEAPFROG: {
+            // THE DOC SETS ARE INTERSECTED CONTAINER BY CONTAINER, THEN THE SHORTEST FULLY DECODED TERM
+            // LIST IS FILTERED THROUGH THEM IN ONE PASS; WHAT IS LEFT JOINS THE LEAPFROG AS ONE CHILD
+            vector<unique_ptr<DocIterator>> positives, negatives;
+            shared_ptr<const RoaringBitmap> sets;
+            const QueryPlan *shortest = nullptr;
+            for (const auto &child : plan.children) {
+                shared_ptr<const RoaringBitmap> set;
+                if (child->node->type == QueryNodeType::NOT) {
+                    negatives.push_back(buildPlanned(*child->children[0], ctx));
+                } else if (child->strategy == PlanStrategy::DOC_SET && (set = ctx.docSet(child->termId))) {
+                    sets = sets ? make_shared<const RoaringBitmap>(intersectBitmaps(*sets, *set)) : move(set);
+                } else if (child->strategy == PlanStrategy::DECODE && !shortest) {
+                    shortest = child.get();
+                } else {
+                    positives.push_back(buildPlanned(*child, ctx));
+                }
+            }
+            const PostingList *list = shortest ? ctx.postings(shortest->node->tokens[0].first, false) : nullptr;
+            if (sets && list) {
+                vector<int> docs(list->docIds);
+                docs.resize(intersectListBitmap(docs.data(), docs.size(), *sets, docs.data()));
+                positives.push_back(make_unique<DocListIterator>(move(docs)));
+            } else {
+                if (sets) positives.push_back(make_unique<DocSetIterator>(move(sets)));
+                if (shortest) positives.push_back(buildPlanned(*shortest, ctx));
+            }
+            unique_ptr<DocIterator> base = positives.empty()
+                ? make_unique<AllDocsIterator>(ctx.index().maxDocId())
+                : combineAll(move(positives), true);
+            if (negatives.empty()) return base;
+            return make_unique<ExclusionIterator>(move(base), combineAll(move(negatives), false));
+        }
+        case PlanStrategy::MERGE: {
+            // THE DOC SETS ARE UNIONED WORD BY WORD, AND WHEN THERE ARE ANY THE FULLY DECODED TERM LISTS
+            // ARE SET INTO THE SAME BITMAP INSTEAD OF JOINING THE HEAP
+            vector<unique_ptr<DocIterator>> children;
+            vector<const QueryPlan *> lists;
+            shared_ptr<const RoaringBitmap> sets;
+            for (const auto &child : plan.children) {
+                shared_ptr<const RoaringBitmap> set;
+                if (child->strategy == PlanStrategy::DOC_SET && (set = ctx.docSet(child->termId))) {
+                    sets = sets ? make_shared<const RoaringBitmap>(unionBitmaps(*sets, *set)) : move(set);
+                } else if (child->strategy == PlanStrategy::DECODE) {
+                    lists.push_back(child.get());
+                } else {
+                    children.push_back(buildPlanned(*child, ctx));
+                }
+            }
+            for (const QueryPlan *child : lists) {
+                const PostingList *list = sets ? ctx.postings(child->node->tokens[0].first, false) : nullptr;
+                if (list) {
+                    sets = make_shared<const RoaringBitmap>(unionListBitmap(list->docIds.data(), list->size(), *sets));
+                } else {
+                    children.push_back(buildPlanned(*child, ctx));
+                }
+            }
+            if (sets) children.push_back(make_unique<DocSetIterator>(move(sets)));
+            return combineAll(move(children), false);
+        }
+        case PlanStrategy::EXCLUDE:
+            return make_unique<ExclusionIterator>(make_unique<AllDocsIterator>(ctx.index().maxDocId()),
+                                                  buildPlanned(*plan.children[0], ctx));
+    }
+    return make_unique<EmptyIterator>();
+}
+
+size_t countPlanned(const QueryPlan &plan, QueryContext &ctx) {
+    const QueryNode &node = *plan.node;
+    switch (plan.strategy) {
+        case PlanStrategy::EMPTY:
+            return 0;
+        case PlanStrategy::DECODE:
+        case PlanStrategy::SKIP_CURSOR:
+        case PlanStrategy::DOC_SET:
+            return ctx.index().entry(plan.termId).df;
+        case PlanStrategy::BIWORD: {
+            // A TWO-WORD EXACT PHRASE IS ONE BIWORD LIST (WHEN THE PAIR WAS KEPT)
+            const auto &tokens = node.tokens;
+            if (tokens.size() == 2 && tokens[1].second == tokens[0].second + 1) {
+                int termId = ctx.biwords()->findTerm(tokens[0].first + " " + tokens[1].first);
+                if (termId >= 0) return ctx.biwords()->entry(termId).df;
+            }
+            break;
+        }
+        case PlanStrategy::HEAP_UNION:
+            if (plan.expansion.termIds.size() == 1) return ctx.index().entry(plan.expansion.termIds[0]).df;
+            break;
+        case PlanStrategy::EXCLUDE:
+            return (size_t)max(ctx.index().maxDocId(), 0) - countPlanned(*plan.children[0], ctx);
+        default:
+            break;
+    }
+    size_t count = 0;
+    for (unique_ptr<DocIterator> it = buildPlanned(plan, ctx); it->doc() != END_DOC; it->next()) ++count;
+    return count;
+}
+
+} // namespace
+
+unique_ptr<DocIterator> buildIterator(const QueryNode &node, QueryContext &ctx) {
+    return buildPlanned(*planQuery(ctx.index(), node, ctx.biwords()), ctx);
+}
+
+vector<int> executeQuery(const IndexReader &index, const QueryNode &query, PostingCache *cache,
+                         const IndexReader *biwords) {
+    return executeQueryFirst(index, query, SIZE_MAX, cache, biwords);
+}
+
+vector<int> executeQueryFirst(const IndexReader &index, const QueryNode &query, size_t limit, PostingCache *cache,
+                              const IndexReader *biwords) {
+    QueryContext ctx(index, cache, biwords);
+    unique_ptr<DocIterator> it = buildIterator(query, ctx);
+    vector<int> matches;
+    for (; matches.size() < limit && it->doc() != END_DOC; it->next()) matches.push_back(it->doc());
+    return matches;
+}
+
+size_t countQueryMatches(const IndexReader &index, const QueryNode &query, PostingCache *cache,
+                         const IndexReader *biwords) {
+    QueryContext ctx(index, cache, biwords);
+    return countPlanned(*planQuery(index, query, biwords), ctx);
+}
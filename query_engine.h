@@ -0,0 +1,146 @@
+#ifndef _QUERY_ENGINE_H_
+#define _QUERY_ENGINE_H_
+
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "binary_index.h"
+#include "posting_cache.h"
+#include "query_parser.h"
+#include "roaring.h"
+
+// CURSOR OVER ONE DECODED POSTING LIST
+class PostingIterator {
+public:
+    explicit PostingIterator(const PostingList *postings) : postings_(postings) {}
+
+    int doc() const { return index_ < postings_->size() ? postings_->docIds[index_] : END_DOC; }
+    void next() { ++index_; }
+    // MOVE TO THE FIRST DOC >= target (GALLOPING FROM THE CURRENT POSITION)
+    void advance(int target);
+
+    size_t cost() const { return postings_->size(); }
+    uint32_t tf() const { return postings_->tf(index_); }
+    const int *positions() const { return postings_->positions.data() + postings_->posStarts[index_]; }
+    size_t positionCount() const { return tf(); }
+
+private:
+    const PostingList *postings_;
+    size_t index_ = 0;
+};
+
+// REUSABLE BUFFERS FOR PHRASE VERIFICATION
+struct PhraseScratch {
+    std::vector<int> candidates;  // CANDIDATE PHRASE START POSITIONS
+    std::vector<size_t> order;    // TERMS BY ASCENDING IN-DOC FREQUENCY
+    std::vector<size_t> cursors;  // PER-TERM POSITION CURSORS FOR SLOPPY / NEAR MATCHING
+};
+
+// HOW A PHRASE ITERATOR VERIFIES THE POSITIONS OF A CANDIDATE DOC
+enum class PositionMatch { EXACT, SLOPPY, NEAR };
+
+// CHECK IF THE PHRASE OCCURS IN THE DOCUMENT ALL ITERATORS ARE POSITIONED ON.
+// terms[i] MUST OCCUR AT offsets[i] RELATIVE TO THE PHRASE START. THE TERM WITH THE FEWEST
+// POSITIONS IN THIS DOC ANCHORS THE CANDIDATES; THE OTHERS FILTER THEM RAREST FIRST
+bool phraseExistsInDoc(const std::vector<PostingIterator> &terms, const std::vector<int> &offsets,
+                       PhraseScratch &scratch);
+
+// SLOPPY PHRASE: THE TERMS OCCUR IN QUERY ORDER AND THE MATCH SPANS AT MOST slop MORE WORDS THAN
+// THE QUERY DOES. ONE FORWARD PASS: FOR EACH START POSITION THE OTHER TERMS TAKE THEIR EARLIEST
+// FOLLOWING OCCURRENCE, AND SINCE STARTS INCREASE NO CURSOR EVER MOVES BACK
+bool sloppyPhraseExistsInDoc(const std::vector<PostingIterator> &terms, const std::vector<int> &offsets,
+                             int slop, PhraseScratch &scratch);
+
+// PROXIMITY: ONE OCCURRENCE OF EVERY TERM, IN ANY ORDER, WITH AT MOST maxGap OTHER WORDS INSIDE
+// THEIR SPAN. SLIDING-WINDOW MERGE: THE WINDOW IS THE CURRENT OCCURRENCE OF EACH TERM AND THE
+// TERM AT THE LEFT EDGE IS ADVANCED UNTIL A LIST RUNS OUT
+bool termsNearInDoc(const std::vector<PostingIterator> &terms, int maxGap, PhraseScratch &scratch);
+
+// DOCUMENT ITERATOR OF A QUERY TREE. A NEW ITERATOR IS ALREADY POSITIONED ON ITS FIRST MATCH;
+// doc() IS END_DOC ONCE EXHAUSTED
+class DocIterator {
+public:
+    virtual ~DocIterator() = default;
+    virtual int doc() const = 0;
+    virtual void next() = 0;
+    // MOVE TO THE FIRST MATCH >= target; NO-OP IF ALREADY THERE
+    virtual void advance(int target) = 0;
+    // UPPER BOUND ON THE NUMBER OF MATCHES, USED TO ORDER CHILDREN
+    virtual size_t cost() const = 0;
+};
+
+// INCLUSIVE DOC-ID RANGE ONE SHARD OF A QUERY RUNS OVER (sharded_query.h)
+struct DocRange {
+    int first = 0;
+    int last = END_DOC;
+
+    bool whole() const { return first <= 0 && last == END_DOC; }
+};
+
+// PER-QUERY STATE: DECODES EACH DISTINCT TERM ONCE (OR TAKES IT FROM THE SHARED POSTING CACHE)
+// AND KEEPS IT ALIVE FOR THE ITERATORS. RESTRICTED TO A DOC RANGE, IT DECODES ONLY THE PART OF EVERY
+// LIST IN THAT RANGE (BYPASSING THE CACHE); ITERATORS MAY STILL YIELD DOCS OUTSIDE IT, SO THE CALLER
+// STARTS WITH advance(range.first) AND STOPS PAST range.last
+class QueryContext {
+public:
+    explicit QueryContext(const IndexReader &index, PostingCache *cache = nullptr,
+                          const IndexReader *biwords = nullptr, DocRange range = DocRange())
+        : index_(index), cache_(cache), biwords_(biwords), range_(range) {}
+    const IndexReader &index() const { return index_; }
+    const DocRange &range() const { return range_; }
+    bool hasBiwords() const { return biwords_ != nullptr; }
+    const IndexReader *biwords() const { return biwords_; }
+    // nullptr IF THE TERM IS NOT IN THE INDEX. WITHOUT POSITIONS ONLY DOC IDS AND TFS ARE DECODED
+    const PostingList *postings(const std::string &term, bool withPositions = true);
+    // POSTINGS OF THE ADJACENT PAIR "first second" (POSITIONS OF first); nullptr IF NOT INDEXED
+    const PostingList *biwordPostings(const std::string &first, const std::string &second);
+    // DOC IDS (NO TFS OR POSITIONS) OF ALL THE termIds A WILDCARD / FUZZY TERM EXPANDED TO, UNIONED IN
+    // ONE PASS. key IS THE NODE'S describeQuery() TEXT
+    const PostingList *expansionPostings(const std::string &key, const std::vector<int> &termIds);
+    // ROARING DOC SET OF A DENSE TERM (binary_index.h); nullptr IF IT HAS NONE
+    std::shared_ptr<const RoaringBitmap> docSet(int termId);
+
+private:
+    struct Decoded {
+        std::shared_ptr<const PostingList> docsOnly;
+        std::shared_ptr<const PostingList> full;
+        std::shared_ptr<const RoaringBitmap> docSet;
+    };
+
+    const IndexReader &index_;
+    PostingCache *cache_;
+    const IndexReader *biwords_;
+    DocRange range_;
+    // BIWORD KEYS CONTAIN A SPACE, WILDCARD KEYS A '*' AND FUZZY KEYS A '~', SO NONE CLASHES WITH TERMS
+    std::map<std::string, Decoded> decoded_;
+};
+
+// COMPILE A PARSED QUERY INTO AN ITERATOR TREE, FOLLOWING ITS COST-BASED PLAN (query_planner.h):
+//   TERM -> POSTING CURSOR (A LAZY SKIP CURSOR WHEN A RARER TERM DRIVES IT, THE DOC SET OF A DENSE TERM)
+//   PHRASE / NEAR -> RAREST-DRIVEN CONJUNCTION + POSITIONAL CHECK
+//   (EXACT PHRASES USE BIWORD LISTS FOR ADJACENT PAIRS WHEN A BIWORD INDEX IS AVAILABLE)
+//   WILDCARD / FUZZY -> DISJUNCTION OF THE EXPANDED TERMS (A HEAP OF CURSORS FOR A FEW, ONE
+//                       BITMAP-UNIONED LIST FOR MANY)
+//   AND  -> LEAPFROG CONJUNCTION    OR     -> MIN-HEAP DISJUNCTION
+//   (DOC SETS ARE FIRST COMBINED WITH EACH OTHER AND WITH FULLY DECODED TERM LISTS BY THE ROARING KERNELS)
+//   NOT  -> EXCLUSION (AGAINST ALL DOCS WHEN THERE IS NOTHING POSITIVE TO EXCLUDE FROM)
+std::unique_ptr<DocIterator> buildIterator(const QueryNode &node, QueryContext &ctx);
+
+// RUN A PARSED QUERY; RETURNS MATCHING DOC IDS IN ASCENDING ORDER
+std::vector<int> executeQuery(const IndexReader &index, const QueryNode &query, PostingCache *cache = nullptr,
+                              const IndexReader *biwords = nullptr);
+
+// THE FIRST limit MATCHING DOC IDS IN ASCENDING ORDER. THE ITERATOR STOPS AT THE limit-TH VERIFIED
+// MATCH, SO EXISTENCE CHECKS AND FIRST PAGES DO NOT PAY FOR THE REST OF THE RESULT SET
+std::vector<int> executeQueryFirst(const IndexReader &index, const QueryNode &query, size_t limit,
+                                   PostingCache *cache = nullptr, const IndexReader *biwords = nullptr);
+
+// NUMBER OF MATCHING DOCS WITHOUT COLLECTING THEM. TERMS, SINGLE-TERM EXPANSIONS AND TWO-WORD EXACT
+// PHRASES WITH A BIWORD LIST ARE ANSWERED FROM THE LEXICON DF WITHOUT DECODING ANY POSTINGS, NOT x AS
+// maxDocId - COUNT(x); ANYTHING ELSE WALKS ITS ITERATOR
+size_t countQueryMatches(const IndexReader &index, const QueryNode &query, PostingCache *cache = nullptr,
+                         const IndexReader *biwords = nullptr);
+
+#endif
@@ -0,0 +1,340 @@
+#include "query_parser.h"
+#include "fuzzy.h"
+#include "tokenizer.h"
+#include "wildcard.h"
+#include <cctype>
+
+using namespace std;
+
+namespace {
+
+enum class LexType { WORD, WILDCARD, FUZZY, QUOTED, LPAREN, RPAREN, AND, OR, NOT, NEAR, END };
+
+struct Lexeme {
+    LexType type;
+    string text;
+    int number = 0;  // QUOTED: SLOP FROM A TRAILING ~k; NEAR: DISTANCE; FUZZY: EDITS (-1 = BY LENGTH)
+};
+
+// PARSE DIGITS AT line[i...] INTO value; RETURNS FALSE IF THERE ARE NONE
+bool lexNumber(const string &line, size_t &i, int &value) {
+    size_t start = i;
+    value = 0;
+    while (i < line.size() && isdigit(static_cast<unsigned char>(line[i])) && value < 1000000) {
+        value = value * 10 + (line[i] - '0');
+        ++i;
+    }
+    return i > start;
+}
+
+bool lexQuery(const string &line, vector<Lexeme> &out, string &error) {
+    size_t i = 0;
+    while (i < line.size()) {
+        char c = line[i];
+        if (isspace(static_cast<unsigned char>(c))) {
+            ++i;
+        } else if (c == '(') {
+            out.push_back({LexType::LPAREN, "("});
+            ++i;
+        } else if (c == ')') {
+            out.push_back({LexType::RPAREN, ")"});
+            ++i;
+        } else if (c == '"') {
+            size_t close = line.find('"', i + 1);
+            if (close == string::npos) {
+                error = "UNTERMINATED QUOTE";
+                return false;
+            }
+            Lexeme quoted{LexType::QUOTED, line.substr(i + 1, close - i - 1)};
+            i = close + 1;
+            if (i < line.size() && line[i] == '~') {
+                ++i;
+                if (!lexNumber(line, i, quoted.number)) {
+                    error = "EXPECTED A NUMBER AFTER '~'";
+                    return false;
+                }
+            }
+            out.push_back(quoted);
+        } else {
+            size_t start = i;
+            while (i < line.size() && !isspace(static_cast<unsigned char>(line[i])) &&
+                   line[i] != '(' && line[i] != ')' && line[i] != '"') {
+                ++i;
+            }
+            string word = line.substr(start, i - start);
+            if (word == "AND") {
+                out.push_back({LexType::AND, word});
+            } else if (word == "OR") {
+                out.push_back({LexType::OR, word});
+            } else if (word == "NOT") {
+                out.push_back({LexType::NOT, word});
+            } else if (word == "NEAR") {
+                out.push_back({LexType::NEAR, word, DEFAULT_NEAR_DISTANCE});
+            } else if (word.rfind("NEAR/", 0) == 0) {
+                size_t digits = 5;
+                Lexeme near{LexType::NEAR, word};
+                if (!lexNumber(word, digits, near.number) || digits != word.size()) {
+                    error = "BAD PROXIMITY OPERATOR '" + word + "'";
+                    return false;
+                }
+                out.push_back(near);
+            } else if (word.find('~') != string::npos) {
+                size_t tilde = word.rfind('~'), digits = tilde + 1;
+                Lexeme fuzzy{LexType::FUZZY, word.substr(0, tilde), -1};
+                if (digits < word.size() && (!lexNumber(word, digits, fuzzy.number) || digits != word.size())) {
+                    error = "BAD FUZZY TERM '" + word + "'";
+                    return false;
+                }
+                if (fuzzy.number > FUZZY_MAX_EDITS) {
+                    error = "FUZZY TERMS ALLOW AT MOST " + to_string(FUZZY_MAX_EDITS) + " EDITS";
+                    return false;
+                }
+                out.push_back(fuzzy);
+            } else if (word.find(WILDCARD_CHAR) != string::npos) {
+                out.push_back({LexType::WILDCARD, word});
+            } else {
+                out.push_back({LexType::WORD, word});
+            }
+        }
+    }
+    out.push_back({LexType::END, ""});
+    return true;
+}
+
+unique_ptr<QueryNode> makeTextNode(const string &text, bool commonGrams, int slop = 0) {
+    auto tokens = commonGrams ? commonGramPhraseTokens(text) : tokenizeWithPositions(text);
+    if (tokens.empty()) return nullptr;
+    auto node = make_unique<QueryNode>();
+    node->type = tokens.size() == 1 ? QueryNodeType::TERM : QueryNodeType::PHRASE;
+    node->tokens = move(tokens);
+    if (node->type == QueryNodeType::PHRASE) node->slop = slop;
+    return node;
+}
+
+// KEEP LETTERS (LOWERCASED) AND SINGLE '*'S; A PATTERN WITHOUT ANY LETTER IS AN ERROR
+unique_ptr<QueryNode> makeWildcardNode(const string &text, string &error) {
+    string pattern;
+    for (char c : text) {
+        if (c == WILDCARD_CHAR) {
+            if (pattern.empty() || pattern.back() != WILDCARD_CHAR) pattern.push_back(c);
+        } else if (isalpha(static_cast<unsigned char>(c))) {
+            pattern.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        }
+    }
+    if (pattern.find_first_not_of(WILDCARD_CHAR) == string::npos) {
+        error = "WILDCARD '" + text + "' NEEDS AT LEAST ONE LETTER";
+        return nullptr;
+    }
+    auto node = make_unique<QueryNode>();
+    node->type = QueryNodeType::WILDCARD;
+    node->tokens.emplace_back(pattern, 0);
+    return node;
+}
+
+// A STOP WORD IS DROPPED LIKE ANY OTHER; ZERO EDITS IS A PLAIN TERM
+unique_ptr<QueryNode> makeFuzzyNode(const string &text, int edits) {
+    auto tokens = tokenizeWithPositions(text);
+    if (tokens.empty()) return nullptr;
+    auto node = make_unique<QueryNode>();
+    node->tokens.emplace_back(tokens[0].first, 0);
+    node->slop = edits < 0 ? defaultFuzzyEdits(tokens[0].first) : edits;
+    node->type = node->slop > 0 ? QueryNodeType::FUZZY : QueryNodeType::TERM;
+    return node;
+}
+
+// RECURSIVE DESCENT:
+//   orExpr  := andExpr ("OR" andExpr)*
+//   andExpr := unary (["AND"] unary)*
+//   unary   := "NOT" unary | nearExpr
+//   nearExpr:= primary ("NEAR/k" primary)*     (EVERY OPERAND A SINGLE WORD)
+//   primary := "(" orExpr ")" | QUOTED | WORD | WILDCARD | FUZZY
+// AN OPERAND THAT TOKENIZES TO NOTHING (STOP WORD) IS RETURNED AS nullptr AND DROPPED
+class Parser {
+public:
+    Parser(const vector<Lexeme> &lexemes, bool commonGrams) : lex_(lexemes), commonGrams_(commonGrams) {}
+
+    unique_ptr<QueryNode> parse(string &error) {
+        auto node = parseOr();
+        if (error_.empty() && peek() != LexType::END) error_ = "UNEXPECTED '" + lex_[pos_].text + "'";
+        error = error_;
+        return error_.empty() ? move(node) : nullptr;
+    }
+
+private:
+    LexType peek() const { return lex_[pos_].type; }
+
+    static unique_ptr<QueryNode> combine(QueryNodeType type, vector<unique_ptr<QueryNode>> parts) {
+        if (parts.empty()) return nullptr;
+        if (parts.size() == 1) return move(parts[0]);
+        auto node = make_unique<QueryNode>();
+        node->type = type;
+        for (auto &part : parts) {
+            // FLATTEN NESTED NODES OF THE SAME TYPE
+            if (part->type == type) {
+                for (auto &child : part->children) node->children.push_back(move(child));
+            } else {
+                node->children.push_back(move(part));
+            }
+        }
+        return node;
+    }
+
+    unique_ptr<QueryNode> parseOr() {
+        vector<unique_ptr<QueryNode>> parts;
+        bool more = true;
+        while (more && error_.empty()) {
+            if (auto part = parseAnd()) parts.push_back(move(part));
+            more = peek() == LexType::OR;
+            if (more) ++pos_;
+        }
+        return combine(QueryNodeType::OR, move(parts));
+    }
+
+    unique_ptr<QueryNode> parseAnd() {
+        vector<unique_ptr<QueryNode>> parts;
+        bool expectOperand = true;
+        while (error_.empty()) {
+            LexType t = peek();
+            if (t == LexType::AND) {
+                if (expectOperand) { error_ = "MISPLACED AND"; break; }
+                ++pos_;
+                expectOperand = true;
+                continue;
+            }
+            if (t == LexType::OR || t == LexType::RPAREN || t == LexType::END) break;
+            if (auto part = parseUnary()) parts.push_back(move(part));
+            expectOperand = false;
+        }
+        if (error_.empty() && expectOperand) {
+            error_ = peek() == LexType::END ? "QUERY ENDS WHERE AN OPERAND WAS EXPECTED"
+                                            : "EXPECTED AN OPERAND BEFORE '" + lex_[pos_].text + "'";
+        }
+        return combine(QueryNodeType::AND, move(parts));
+    }
+
+    unique_ptr<QueryNode> parseUnary() {
+        if (peek() == LexType::NOT) {
+            ++pos_;
+            auto child = parseUnary();
+            if (!child) return nullptr;
+            auto node = make_unique<QueryNode>();
+            node->type = QueryNodeType::NOT;
+            node->children.push_back(move(child));
+            return node;
+        }
+        return parseNear();
+    }
+
+    unique_ptr<QueryNode> parseNear() {
+        auto first = parsePrimary();
+        if (peek() != LexType::NEAR) return first;
+
+        auto node = make_unique<QueryNode>();
+        node->type = QueryNodeType::NEAR;
+        node->slop = lex_[pos_].number;
+        auto addOperand = [&](unique_ptr<QueryNode> operand) {
+            if (!operand) return;  // STOP WORD
+            if (operand->type != QueryNodeType::TERM) {
+                error_ = "NEAR OPERANDS MUST BE SINGLE WORDS";
+                return;
+            }
+            for (const auto &token : node->tokens) {
+                if (token.first == operand->tokens[0].first) return;
+            }
+            node->tokens.push_back(operand->tokens[0]);
+        };
+        addOperand(move(first));
+        while (error_.empty() && peek() == LexType::NEAR) {
+            // CHAINED NEARS USE THE TIGHTEST DISTANCE
+            node->slop = min(node->slop, lex_[pos_].number);
+            ++pos_;
+            addOperand(parsePrimary());
+        }
+        if (!error_.empty() || node->tokens.empty()) return nullptr;
+        if (node->tokens.size() == 1) {
+            node->type = QueryNodeType::TERM;
+            node->slop = 0;
+        }
+        return node;
+    }
+
+    unique_ptr<QueryNode> parsePrimary() {
+        const Lexeme &lexeme = lex_[pos_];
+        switch (lexeme.type) {
+            case LexType::LPAREN: {
+                ++pos_;
+                auto inner = parseOr();
+                if (error_.empty() && peek() != LexType::RPAREN) error_ = "MISSING ')'";
+                else if (error_.empty()) ++pos_;
+                return inner;
+            }
+            case LexType::QUOTED:
+            case LexType::WORD:
+                ++pos_;
+                return makeTextNode(lexeme.text, commonGrams_, lexeme.number);
+            case LexType::WILDCARD:
+                ++pos_;
+                return makeWildcardNode(lexeme.text, error_);
+            case LexType::FUZZY:
+                ++pos_;
+                return makeFuzzyNode(lexeme.text, lexeme.number);
+            default:
+                error_ = lexeme.type == LexType::END ? "QUERY ENDS WHERE AN OPERAND WAS EXPECTED"
+                                                     : "UNEXPECTED '" + lexeme.text + "'";
+                return nullptr;
+        }
+    }
+
+    const vector<Lexeme> &lex_;
+    bool commonGrams_;
+    size_t pos_ = 0;
+    string error_;
+};
+
+} // namespace
+
+unique_ptr<QueryNode> parseQuery(const string &line, string &error, bool commonGrams) {
+    error.clear();
+    vector<Lexeme> lexemes;
+    if (!lexQuery(line, lexemes, error)) return nullptr;
+
+    // NO OPERATORS, QUOTES OR PARENTHESES: KEEP THE ORIGINAL WHOLE-LINE PHRASE SEMANTICS
+    bool plain = true;
+    for (const Lexeme &l : lexemes) plain = plain && (l.type == LexType::WORD || l.type == LexType::END);
+    if (plain) return makeTextNode(line, commonGrams);
+
+    return Parser(lexemes, commonGrams).parse(error);
+}
+
+string describeQuery(const QueryNode &node) {
+    switch (node.type) {
+        case QueryNodeType::TERM:
+        case QueryNodeType::WILDCARD:
+            return node.tokens[0].first;
+        case QueryNodeType::PHRASE: {
+            string out = "\"";
+            for (size_t i = 0; i < node.tokens.size(); ++i) {
+                if (i > 0) {
+                    for (int gap = node.tokens[i].second - node.tokens[i - 1].second; gap > 1; --gap) out += " ?";
+                    out += " ";
+                }
+                out += node.tokens[i].first;
+            }
+            out += "\"";
+            if (node.slop > 0) out += "~" + to_string(node.slop);
+            return out;
+        }
+        case QueryNodeType::FUZZY:
+            return node.tokens[0].first + "~" + to_string(node.slop);
+        case QueryNodeType::NEAR: {
+            string out = "(NEAR/" + to_string(node.slop);
+            for (const auto &token : node.tokens) out += " " + token.first;
+            return out + ")";
+        }
+        default: {
+            string out = node.type == QueryNodeType::AND ? "(AND" : node.type == QueryNodeType::OR ? "(OR" : "(NOT";
+            for (const auto &child : node.children) out += " " + describeQuery(*child);
+            return out + ")";
+        }
+    }
+}
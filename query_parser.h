@@ -0,0 +1,46 @@
+#ifndef _QUERY_PARSER_H_
+#define _QUERY_PARSER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+// QUERY LANGUAGE
+//   happy day                   NO OPERATORS/QUOTES/PARENTHESES: THE WHOLE LINE IS ONE PHRASE
+//   "happy day" AND sun         QUOTED PHRASES, AND / OR / NOT (UPPERCASE), PARENTHESES
+//   sunny (walk OR run)         ADJACENT OPERANDS ARE AN IMPLICIT AND
+//   park NOT rain               NOT BINDS TIGHTEST: park AND (NOT rain)
+//   "happy day"~2               SLOPPY PHRASE: SAME ORDER, UP TO 2 EXTRA WORDS IN BETWEEN IN TOTAL
+//   happy NEAR/3 day            PROXIMITY: ANY ORDER, AT MOST 3 OTHER WORDS BETWEEN THEM
+//                               (NEAR ALONE MEANS NEAR/5; OPERANDS MUST BE SINGLE WORDS)
+//   optim*  *ness  o*ise        WILDCARD: ANY INDEXED TERM MATCHING THE PATTERN ('*' = ANY RUN OF
+//                               LETTERS), MATCHED AGAINST THE STEMS AS INDEXED; SEE wildcard.h
+//   netwrok~1  netwrok~         FUZZY: ANY INDEXED TERM WITHIN 1 (UP TO 2) EDITS OF THE STEMMED WORD;
+//                               A BARE ~ ALLOWS 1 EDIT FOR STEMS UP TO 5 LETTERS, 2 BEYOND; SEE fuzzy.h
+// WORDS GO THROUGH tokenizeWithPositions, SO STOP WORDS AND SHORT WORDS DROP OUT OF THE QUERY
+
+enum class QueryNodeType { TERM, PHRASE, NEAR, WILDCARD, FUZZY, AND, OR, NOT };
+
+static const int DEFAULT_NEAR_DISTANCE = 5;
+
+struct QueryNode {
+    QueryNodeType type;
+    // TERM: ONE STEMMED TOKEN; PHRASE: STEMMED TOKENS WITH THEIR POSITIONS IN THE QUOTED TEXT;
+    // NEAR: THE DISTINCT STEMMED OPERANDS; WILDCARD: THE LOWERCASED PATTERN; FUZZY: ONE STEMMED TOKEN
+    std::vector<std::pair<std::string, int>> tokens;
+    // PHRASE: ALLOWED EXTRA DISTANCE (0 = EXACT); NEAR: MAX WORDS BETWEEN THE OPERANDS; FUZZY: MAX EDITS
+    int slop = 0;
+    std::vector<std::unique_ptr<QueryNode>> children;
+};
+
+// PARSE A QUERY LINE. RETURNS nullptr WITH AN EMPTY error WHEN NOTHING SEARCHABLE REMAINS
+// (E.G. ONLY STOP WORDS), OR nullptr WITH error SET ON A SYNTAX ERROR.
+// commonGrams: THE INDEX HAS COMMON GRAMS, SO PHRASES KEEP THEIR STOP WORDS AS GRAM TOKENS
+std::unique_ptr<QueryNode> parseQuery(const std::string &line, std::string &error, bool commonGrams = false);
+
+// CANONICAL TEXT FORM OF A PARSED QUERY, E.G. (AND "happi ? day"~1 (NEAR/3 sun park) (NOT sad))
+// A '?' STANDS FOR A SKIPPED POSITION INSIDE A PHRASE
+std::string describeQuery(const QueryNode &node);
+
+#endif
@@ -0,0 +1,277 @@
+#include "query_planner.h"
+#include "fuzzy.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+
+using namespace std;
+
+namespace {
+
+const double UNBOUNDED = numeric_limits<double>::infinity();
+
+class Planner {
+public:
+    Planner(const IndexReader &index, const IndexReader *biwords)
+        : index_(index), biwords_(biwords), docs_(max(1, index.maxDocId())),
+          tokens_(max<double>(1.0, (double)index.totalDocLength())) {}
+
+    // STATISTICS BOTTOM-UP; EVERY TERM IS PLANNED AS A FULL DECODE UNTIL assign() KNOWS ITS BOUND
+    unique_ptr<QueryPlan> plan(const QueryNode &node) {
+        auto p = make_unique<QueryPlan>();
+        p->node = &node;
+        switch (node.type) {
+            case QueryNodeType::TERM: planTerm(*p); break;
+            case QueryNodeType::PHRASE:
+            case QueryNodeType::NEAR: planPhrase(*p); break;
+            case QueryNodeType::WILDCARD:
+            case QueryNodeType::FUZZY: planExpansion(*p); break;
+            case QueryNodeType::AND: planAnd(*p); break;
+            case QueryNodeType::OR: planOr(*p); break;
+            case QueryNodeType::NOT: planNot(*p); break;
+        }
+        return p;
+    }
+
+    // TOP-DOWN: bound IS THE MOST DOCS THIS SUBTREE CAN BE ADVANCED TO. PICKS THE TERM STRATEGIES AND
+    // SUMS THE COSTS
+    void assign(QueryPlan &p, double bound) {
+        switch (p.strategy) {
+            case PlanStrategy::DECODE:
+            case PlanStrategy::SKIP_CURSOR:
+            case PlanStrategy::DOC_SET: {
+                double df = p.maxMatches;
+                double blocks = ceil(df / POSTING_BLOCK_SIZE);
+                bool skip = bound < blocks;
+                p.strategy = skip ? PlanStrategy::SKIP_CURSOR : PlanStrategy::DECODE;
+                p.cost = skip ? min(df, bound * POSTING_BLOCK_SIZE) : df;
+                // A DOC SET COSTS THE 64-BIT WORDS IT IS LOADED FROM
+                double words = (double)index_.entry(p.termId).docSetBytes / sizeof(uint64_t);
+                if (index_.hasDocSet(p.termId) && words < p.cost) {
+                    p.strategy = PlanStrategy::DOC_SET;
+                    p.cost = words;
+                }
+                return;
+            }
+            case PlanStrategy::LEAPFROG: {
+                // THE DRIVER SEES THE WHOLE BOUND; EVERY OTHER CHILD ONLY THE DOCS THE DRIVER PROPOSES
+                bool hasPositive = !p.children.empty() && p.children[0]->node->type != QueryNodeType::NOT;
+                double driven = min(bound, hasPositive ? p.children[0]->maxMatches : docs_);
+                p.cost = 0;
+                for (size_t i = 0; i < p.children.size(); ++i) {
+                    assign(*p.children[i], i == 0 && hasPositive ? bound : driven);
+                    p.cost += p.children[i]->cost;
+                }
+                return;
+            }
+            case PlanStrategy::MERGE:
+            case PlanStrategy::EXCLUDE:
+                p.cost = 0;
+                for (auto &child : p.children) {
+                    // A NOT AT THE TOP (OR UNDER AN OR) IS ADVANCED TO EVERY DOC
+                    assign(*child, p.strategy == PlanStrategy::EXCLUDE ? min(bound, docs_) : bound);
+                    p.cost += child->cost;
+                }
+                return;
+            default:
+                return;  // LEAVES WITH A FIXED STRATEGY, EMPTY NODES
+        }
+    }
+
+private:
+    void planTerm(QueryPlan &p) {
+        int termId = index_.findTerm(p.node->tokens[0].first);
+        if (termId < 0) {
+            p.strategy = PlanStrategy::EMPTY;
+            return;
+        }
+        p.strategy = PlanStrategy::DECODE;
+        p.termId = termId;
+        p.matches = p.maxMatches = p.cost = index_.entry(termId).df;
+    }
+
+    void planPhrase(QueryPlan &p) {
+        const QueryNode &node = *p.node;
+        const auto &tokens = node.tokens;
+        vector<const LexiconEntry *> entries;
+        for (const auto &token : tokens) {
+            int termId = index_.findTerm(token.first);
+            if (termId < 0) {
+                p.strategy = PlanStrategy::EMPTY;
+                return;
+            }
+            entries.push_back(&index_.entry(termId));
+        }
+
+        size_t anchor = 0;
+        for (size_t i = 1; i < entries.size(); ++i) {
+            if (entries[i]->df < entries[anchor]->df) anchor = i;
+        }
+        p.maxMatches = entries[anchor]->df;
+
+        // EACH OTHER TERM MUST FALL IN A WINDOW NEXT TO EVERY OCCURRENCE OF THE ANCHOR
+        double window = node.type == QueryNodeType::NEAR ? 2.0 * node.slop + 2.0 : node.slop + 1.0;
+        double occurrences = (double)entries[anchor]->cf;
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (i != anchor) occurrences *= min(1.0, window * entries[i]->cf / tokens_);
+        }
+        p.matches = min(p.maxMatches, occurrences);
+
+        if (node.type == QueryNodeType::PHRASE && node.slop == 0 && biwords_) {
+            // THE SAME GREEDY COVER AS THE BIWORD PHRASE ITERATOR
+            p.strategy = PlanStrategy::BIWORD;
+            auto pair = [&](size_t i) -> const LexiconEntry * {
+                if (tokens[i + 1].second != tokens[i].second + 1) return nullptr;
+                int termId = biwords_->findTerm(tokens[i].first + " " + tokens[i + 1].first);
+                return termId < 0 ? nullptr : &biwords_->entry(termId);
+            };
+            size_t i = 0;
+            while (i < tokens.size()) {
+                const LexiconEntry *biword = i + 1 < tokens.size() ? pair(i) : nullptr;
+                size_t step = biword ? 2 : 1;
+                if (!biword && i > 0) biword = pair(i - 1);
+                const LexiconEntry &e = biword ? *biword : *entries[i];
+                p.cost += (double)e.df + (double)e.cf;
+                p.maxMatches = min(p.maxMatches, (double)e.df);
+                i += step;
+            }
+            if (tokens.size() == 2 && pair(0)) p.matches = p.maxMatches;  // ONE BIWORD LIST: EXACT
+            p.matches = min(p.matches, p.maxMatches);
+            return;
+        }
+        p.strategy = PlanStrategy::POSITIONAL;
+        for (const LexiconEntry *e : entries) p.cost += (double)e->df + (double)e->cf;
+    }
+
+    void planExpansion(QueryPlan &p) {
+        const QueryNode &node = *p.node;
+        p.expansion = node.type == QueryNodeType::WILDCARD ? expandWildcard(index_, node.tokens[0].first)
+                                                           : expandFuzzy(index_, node.tokens[0].first, node.slop);
+        if (p.expansion.termIds.empty()) {
+            p.strategy = PlanStrategy::EMPTY;
+            return;
+        }
+        p.strategy = p.expansion.termIds.size() > HEAP_UNION_MAX_TERMS ? PlanStrategy::BITMAP_UNION
+                                                                       : PlanStrategy::HEAP_UNION;
+        double none = 1.0;
+        for (int termId : p.expansion.termIds) {
+            double df = index_.entry(termId).df;
+            p.cost += df;
+            none *= 1.0 - df / docs_;
+        }
+        p.maxMatches = min(docs_, p.cost);
+        p.matches = docs_ * (1.0 - none);
+    }
+
+    void planAnd(QueryPlan &p) {
+        vector<unique_ptr<QueryPlan>> positives, negatives;
+        for (const auto &child : p.node->children) {
+            auto c = plan(*child);
+            if (child->type != QueryNodeType::NOT && c->strategy == PlanStrategy::EMPTY) {
+                // NOTHING CAN MATCH; KEEP ONLY THE CHILD THAT SHOWS WHY
+                p.strategy = PlanStrategy::EMPTY;
+                p.children.clear();
+                p.children.push_back(move(c));
+                return;
+            }
+            (child->type == QueryNodeType::NOT ? negatives : positives).push_back(move(c));
+        }
+        stable_sort(positives.begin(), positives.end(),
+                    [](const unique_ptr<QueryPlan> &a, const unique_ptr<QueryPlan> &b) {
+                        return a->maxMatches < b->maxMatches;
+                    });
+        p.strategy = PlanStrategy::LEAPFROG;
+        p.matches = docs_;
+        p.maxMatches = positives.empty() ? docs_ : positives[0]->maxMatches;
+        for (auto &c : positives) p.matches *= c->matches / docs_;
+        for (auto &c : negatives) p.matches *= 1.0 - c->children[0]->matches / docs_;
+        for (auto &c : positives) p.children.push_back(move(c));
+        for (auto &c : negatives) p.children.push_back(move(c));
+    }
+
+    void planOr(QueryPlan &p) {
+        double none = 1.0;
+        bool allEmpty = true;
+        for (const auto &child : p.node->children) {
+            auto c = plan(*child);
+            allEmpty = allEmpty && c->strategy == PlanStrategy::EMPTY;
+            none *= 1.0 - c->matches / docs_;
+            p.maxMatches += c->maxMatches;
+            p.children.push_back(move(c));
+        }
+        p.strategy = allEmpty ? PlanStrategy::EMPTY : PlanStrategy::MERGE;
+        p.maxMatches = min(docs_, p.maxMatches);
+        p.matches = docs_ * (1.0 - none);
+    }
+
+    void planNot(QueryPlan &p) {
+        p.children.push_back(plan(*p.node->children[0]));
+        p.strategy = PlanStrategy::EXCLUDE;
+        p.matches = docs_ - p.children[0]->matches;
+        p.maxMatches = docs_;
+    }
+
+    const IndexReader &index_;
+    const IndexReader *biwords_;
+    double docs_;
+    double tokens_;
+};
+
+const char *strategyName(PlanStrategy strategy) {
+    switch (strategy) {
+        case PlanStrategy::EMPTY: return "EMPTY";
+        case PlanStrategy::DECODE: return "DECODE";
+        case PlanStrategy::SKIP_CURSOR: return "SKIP CURSOR";
+        case PlanStrategy::DOC_SET: return "DOC SET";
+        case PlanStrategy::BIWORD: return "BIWORD";
+        case PlanStrategy::POSITIONAL: return "POSITIONAL";
+        case PlanStrategy::HEAP_UNION: return "HEAP UNION";
+        case PlanStrategy::BITMAP_UNION: return "BITMAP UNION";
+        case PlanStrategy::LEAPFROG: return "LEAPFROG";
+        case PlanStrategy::MERGE: return "MERGE";
+        case PlanStrategy::EXCLUDE: return "EXCLUDE";
+    }
+    return "?";
+}
+
+void explain(const QueryPlan &p, int depth, ostringstream &out) {
+    const QueryNode &node = *p.node;
+    out << string(depth * 2, ' ');
+    switch (node.type) {
+        case QueryNodeType::AND: out << "AND"; break;
+        case QueryNodeType::OR: out << "OR"; break;
+        case QueryNodeType::NOT: out << "NOT"; break;
+        default: out << describeQuery(node); break;
+    }
+    out << "  " << strategyName(p.strategy);
+    if (p.strategy == PlanStrategy::HEAP_UNION || p.strategy == PlanStrategy::BITMAP_UNION) {
+        out << " OF " << p.expansion.termIds.size() << (p.expansion.truncated ? "+" : "") << " TERMS";
+    }
+    // A SELECTIVE AND CAN ESTIMATE WELL UNDER ONE MATCH, WHICH WOULD ROUND TO A MISLEADING 0
+    out << "  EST ";
+    if (p.matches > 0 && p.matches < 9.95) {
+        out << fixed << setprecision(1) << p.matches << defaultfloat;
+    } else {
+        out << (long long)llround(p.matches);
+    }
+    out << "  MAX " << (long long)llround(p.maxMatches) << "  COST "
+        << (long long)llround(p.cost) << "\n";
+    for (const auto &child : p.children) explain(*child, depth + 1, out);
+}
+
+} // namespace
+
+unique_ptr<QueryPlan> planQuery(const IndexReader &index, const QueryNode &query, const IndexReader *biwords) {
+    Planner planner(index, biwords);
+    unique_ptr<QueryPlan> plan = planner.plan(query);
+    planner.assign(*plan, UNBOUNDED);
+    return plan;
+}
+
+string explainPlan(const QueryPlan &plan) {
+    ostringstream out;
+    explain(plan, 0, out);
+    return out.str();
+}
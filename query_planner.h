@@ -0,0 +1,54 @@
+#ifndef _QUERY_PLANNER_H_
+#define _QUERY_PLANNER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "binary_index.h"
+#include "query_parser.h"
+#include "wildcard.h"
+
+// HOW ONE NODE OF A PLAN IS EXECUTED
+enum class PlanStrategy {
+    EMPTY,          // PROVABLY NO MATCH (A TERM NOT IN THE INDEX, AN AND WITH SUCH A TERM); NOTHING IS READ
+    DECODE,         // TERM: DECODE ITS WHOLE LIST, THEN GALLOP OVER IT
+    SKIP_CURSOR,    // TERM ONLY ADVANCED TO FEW TARGETS: DECODE JUST THE 128-DOC BLOCKS THEY LAND IN
+    DOC_SET,        // DENSE TERM: ITS ROARING DOC SET, PROBED OR COMBINED WITH OTHERS WORD BY WORD
+    BIWORD,         // EXACT PHRASE OVER BIWORD LISTS
+    POSITIONAL,     // PHRASE / NEAR: CONJUNCTION OF FULL LISTS + POSITION CHECK
+    HEAP_UNION,     // WILDCARD / FUZZY WITH FEW TERMS: HEAP OF CURSORS
+    BITMAP_UNION,   // WILDCARD / FUZZY WITH MANY TERMS: ONE UNIONED DOC LIST
+    LEAPFROG,       // AND: THE CHILD WITH THE FEWEST POSSIBLE MATCHES DRIVES
+    MERGE,          // OR: MIN-HEAP OF THE CHILDREN
+    EXCLUDE,        // NOT: ALL DOCS (OR THE ENCLOSING AND'S MATCHES) MINUS THE CHILD
+};
+
+// COST-BASED PLAN OF A PARSED QUERY, ONE PLAN NODE PER QUERY NODE. BUILT FROM LEXICON STATISTICS
+// ONLY (DF, CF, BLOCK COUNTS, BIWORD DFS), BEFORE ANY POSTING LIST IS DECODED
+struct QueryPlan {
+    const QueryNode *node;
+    PlanStrategy strategy;
+    double matches = 0;      // ESTIMATED MATCHING DOCS (TERMS ASSUMED INDEPENDENT)
+    double maxMatches = 0;   // UPPER BOUND ON THE MATCHES; ORDERS AND CHILDREN
+    double cost = 0;         // ESTIMATED POSTINGS DECODED (DOC + POSITION ENTRIES, DOC SET WORDS) TO RUN THIS SUBTREE
+    int termId = -1;         // DECODE / SKIP_CURSOR / DOC_SET
+    TermExpansion expansion; // HEAP_UNION / BITMAP_UNION
+    // AND: POSITIVE CHILDREN BY maxMatches (DRIVER FIRST), THEN THE NEGATED ONES; OTHERWISE QUERY ORDER
+    std::vector<std::unique_ptr<QueryPlan>> children;
+};
+
+// PLAN A QUERY. EVERY SUBTREE IS PLANNED KNOWING HOW MANY DOCS IT CAN BE ASKED ABOUT: INSIDE AN AND
+// THAT IS AT MOST THE DRIVER'S MATCHES, SO A FREQUENT TERM NEXT TO A RARE ONE GETS A SKIP CURSOR
+// INSTEAD OF A FULL DECODE, AND ONE MISSING TERM EMPTIES THE AND WITHOUT READING THE OTHERS. A DENSE
+// TERM WITH A DOC SET USES IT WHEN THAT IS CHEAPER THAN EITHER
+std::unique_ptr<QueryPlan> planQuery(const IndexReader &index, const QueryNode &query,
+                                     const IndexReader *biwords = nullptr);
+
+// INDENTED, ONE LINE PER PLAN NODE, E.G. FOR zebra AND river AND data OVER 200000 DOCS
+//   AND  LEAPFROG  EST 1.0  MAX 40  COST 8624
+//     zebra  DECODE  EST 40  MAX 40  COST 40
+//     river  SKIP CURSOR  EST 11000  MAX 11000  COST 5120
+//     data  DOC SET  EST 90000  MAX 90000  COST 3464
+std::string explainPlan(const QueryPlan &plan);
+
+#endif
@@ -0,0 +1,357 @@
+#include "query_server.h"
+#include <iostream>
+
+using namespace std;
+
+#ifdef _WIN32
+
+bool runQueryServer(const IndexReader &, const DocTable &, const ServerOptions &) {
+    cerr << "ERROR: THE QUERY SERVER NEEDS A POSIX SYSTEM" << endl;
+    return false;
+}
+
+#else
+
+#include "json.hpp"
+#include "posting_cache.h"
+#include "result_cache.h"
+#include "thread_pool.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fcntl.h>
+#include <memory>
+#include <mutex>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+using json = nlohmann::ordered_json;
+
+namespace {
+
+// SELF-PIPE: THE SIGNAL HANDLER WAKES THE POLL LOOP THROUGH IT
+int wakePipe[2] = {-1, -1};
+
+void onShutdownSignal(int) {
+    char byte = 0;
+    ssize_t written = write(wakePipe[1], &byte, 1);
+    (void)written;
+}
+
+// ONE CLIENT. ITS REQUESTS ARE ANSWERED BY ANY WORKER IN ANY ORDER; FINISHED RESPONSES AT THE FRONT
+// OF THE QUEUE ARE WRITTEN OUT BY ONE WORKER AT A TIME, SO THEY KEEP REQUEST ORDER. THE QUEUE LOCK IS
+// NEVER HELD WHILE WRITING, SO A CLIENT THAT IS SLOW TO READ NEVER STALLS THE POLL THREAD. THE SOCKET
+// IS CLOSED WITH THE LAST REFERENCE, I.E. AFTER THE LAST RESPONSE WAS WRITTEN
+class Connection {
+public:
+    explicit Connection(int fd) : fd_(fd) {}
+    ~Connection() { close(fd_); }
+    Connection(const Connection &) = delete;
+    Connection &operator=(const Connection &) = delete;
+
+    int fd() const { return fd_; }
+    // BYTES READ BUT NOT YET A COMPLETE LINE (POLL THREAD ONLY)
+    string input;
+
+    // SLOT FOR THE RESPONSE TO THE NEXT REQUEST
+    size_t reserve() {
+        lock_guard<mutex> lock(mutex_);
+        pending_.emplace_back();
+        return firstSlot_ + pending_.size() - 1;
+    }
+
+    void respond(size_t slot, string line) {
+        {
+            lock_guard<mutex> lock(mutex_);
+            Pending &p = pending_[slot - firstSlot_];
+            p.line = move(line);
+            p.line.push_back('\n');
+            p.done = true;
+            if (writing_) return;  // THE CURRENT WRITER PICKS IT UP
+            writing_ = true;
+        }
+        string out;
+        while (true) {
+            out.clear();
+            {
+                lock_guard<mutex> lock(mutex_);
+                while (!pending_.empty() && pending_.front().done) {
+                    out += pending_.front().line;
+                    pending_.pop_front();
+                    ++firstSlot_;
+                }
+                if (out.empty()) {
+                    writing_ = false;
+                    return;
+                }
+            }
+            if (!broken_) broken_ = !writeAll(out);
+        }
+    }
+
+private:
+    struct Pending {
+        string line;
+        bool done = false;
+    };
+
+    // FALSE ONCE THE CLIENT HAS GONE (OR STOPPED READING FOR SERVER_WRITE_TIMEOUT_SECONDS); ITS
+    // REMAINING RESPONSES ARE DROPPED
+    bool writeAll(const string &data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = write(fd_, data.data() + sent, data.size() - sent);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            sent += (size_t)n;
+        }
+        return true;
+    }
+
+    int fd_;
+    mutex mutex_;
+    deque<Pending> pending_;
+    size_t firstSlot_ = 0;
+    bool writing_ = false;
+    bool broken_ = false;  // ONLY TOUCHED BY THE WORKER THAT IS WRITING
+};
+
+string errorLine(const string &message) {
+    json out;
+    out["error"] = message;
+    return out.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+// A PLAIN QUERY LINE, OR A JSON REQUEST THAT MAY OVERRIDE THE SERVER'S RESULT MODE
+string handleRequest(const IndexReader &index, const DocTable &docTable, const ServerOptions &options,
+                     ResultCache *cache, PostingCache *postingCache, const ShardOptions &sharding, const string &line) {
+    ResultMode mode = options.mode;
+    string queryText = line;
+    if (line[0] == '{') {
+        json request = json::parse(line, nullptr, false);
+        if (request.is_discarded() || !request.is_object() || !request.contains("query") ||
+            !request["query"].is_string()) {
+            return errorLine("BAD REQUEST: EXPECTED A QUERY LINE OR {\"query\": \"...\"}");
+        }
+        queryText = request["query"].get<string>();
+        if (request.contains("top") && request["top"].is_number_unsigned()) mode.topK = request["top"].get<size_t>();
+        if (request.contains("first") && request["first"].is_number_unsigned()) {
+            mode.firstN = request["first"].get<size_t>();
+        }
+        if (request.contains("count") && request["count"].is_boolean()) mode.countOnly = request["count"].get<bool>();
+    }
+    return answerQuery(index, docTable, queryText, mode, cache, postingCache, options.biwords, sharding);
+}
+
+// BIND AND LISTEN; -1 (AFTER PRINTING AN ERROR) ON FAILURE
+int openListener(const ServerOptions &options) {
+    int fd = -1;
+    if (!options.socketPath.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (options.socketPath.size() >= sizeof(addr.sun_path)) {
+            cerr << "ERROR: SOCKET PATH TOO LONG: " << options.socketPath << endl;
+            return -1;
+        }
+        memcpy(addr.sun_path, options.socketPath.c_str(), options.socketPath.size() + 1);
+        // A SOCKET LEFT BEHIND BY A SERVER THAT DID NOT SHUT DOWN CLEANLY; NEVER REMOVE ANYTHING ELSE
+        struct stat st;
+        if (lstat(options.socketPath.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                cerr << "ERROR: PATH EXISTS AND IS NOT A SOCKET: " << options.socketPath << endl;
+                return -1;
+            }
+            unlink(options.socketPath.c_str());
+        }
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd >= 0 && bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    } else {
+        if (options.tcpPort <= 0 || options.tcpPort > 65535) {
+            cerr << "ERROR: BAD TCP PORT: " << options.tcpPort << endl;
+            return -1;
+        }
+        // LOCAL CLIENTS ONLY: THE PROTOCOL HAS NO AUTHENTICATION
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)options.tcpPort);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int reuse = 1;
+        if (fd >= 0) setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        if (fd >= 0 && bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    if (fd < 0 || listen(fd, SOMAXCONN) < 0) {
+        cerr << "ERROR: CANNOT LISTEN ON "
+             << (options.socketPath.empty() ? "127.0.0.1:" + to_string(options.tcpPort) : options.socketPath) << ": "
+             << strerror(errno) << endl;
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+bool runQueryServer(const IndexReader &index, const DocTable &docTable, const ServerOptions &options) {
+    int listenFd = openListener(options);
+    if (listenFd < 0) return false;
+    if (pipe(wakePipe) < 0) {
+        cerr << "ERROR: CANNOT CREATE THE SHUTDOWN PIPE: " << strerror(errno) << endl;
+        close(listenFd);
+        return false;
+    }
+    fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+
+    struct sigaction onStop{}, oldInt{}, oldTerm{}, oldPipe{};
+    onStop.sa_handler = onShutdownSignal;
+    sigemptyset(&onStop.sa_mask);
+    sigaction(SIGINT, &onStop, &oldInt);
+    sigaction(SIGTERM, &onStop, &oldTerm);
+    // A CLIENT THAT DISCONNECTS EARLY MUST NOT KILL THE SERVER; write() REPORTS EPIPE INSTEAD
+    struct sigaction ignore{};
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGPIPE, &ignore, &oldPipe);
+
+    unique_ptr<ResultCache> cache;
+    if (options.cacheBytes > 0) cache = make_unique<ResultCache>(options.cacheBytes);
+    unique_ptr<PostingCache> postingCache;
+    if (options.postingCacheBytes > 0) postingCache = make_unique<PostingCache>(options.postingCacheBytes);
+    ResultCache *sharedCache = cache.get();
+    PostingCache *sharedPostings = postingCache.get();
+    atomic<size_t> served{0};
+    size_t accepted = 0;
+
+    cout << "QUERY SERVER LISTENING ON "
+         << (options.socketPath.empty() ? "127.0.0.1:" + to_string(options.tcpPort) : options.socketPath) << " WITH "
+         << max<size_t>(1, options.numThreads) << " THREADS (CTRL-C TO STOP)" << endl;
+    {
+        ThreadPool pool(options.numThreads);
+        // SHARDS OF A QUERY QUEUE BEHIND THE PENDING REQUESTS, SO THEY ONLY SPREAD WHEN WORKERS ARE IDLE
+        ShardOptions sharding;
+        sharding.pool = &pool;
+        sharding.shards = options.shards;
+        vector<shared_ptr<Connection>> clients;
+        auto submit = [&](const shared_ptr<Connection> &client, string line) {
+            size_t slot = client->reserve();
+            pool.submit([&, client, slot, line = move(line)] {
+                // EVERY SLOT GETS ITS RESPONSE, AND AN EXCEPTION ESCAPING A WORKER WOULD END THE SERVER
+                string response;
+                try {
+                    response = handleRequest(index, docTable, options, sharedCache, sharedPostings, sharding, line);
+                } catch (const exception &e) {
+                    response = errorLine(string("QUERY FAILED: ") + e.what());
+                }
+                client->respond(slot, move(response));
+                ++served;
+            });
+        };
+        // A FIXED RESPONSE STILL GOES THROUGH THE POOL: respond() MAY BLOCK WRITING TO THE CLIENT
+        auto reply = [&](const shared_ptr<Connection> &client, string response) {
+            size_t slot = client->reserve();
+            pool.submit([client, slot, response = move(response)]() mutable { client->respond(slot, move(response)); });
+        };
+
+        vector<pollfd> fds;
+        char buffer[16 << 10];
+        while (true) {
+            fds.clear();
+            fds.push_back({wakePipe[0], POLLIN, 0});
+            fds.push_back({listenFd, POLLIN, 0});
+            for (const auto &client : clients) fds.push_back({client->fd(), POLLIN, 0});
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR) continue;
+                cerr << "ERROR: poll FAILED: " << strerror(errno) << endl;
+                break;
+            }
+            if (fds[0].revents) break;  // SHUTDOWN REQUESTED
+
+            // READ EVERY READY CLIENT AND QUEUE ITS COMPLETE LINES; NOTHING WAITS FOR AN ANSWER HERE
+            size_t kept = 0;
+            for (size_t i = 0; i < clients.size(); ++i) {
+                shared_ptr<Connection> &client = clients[i];
+                bool open = true;
+                if (fds[i + 2].revents) {
+                    ssize_t n = read(client->fd(), buffer, sizeof(buffer));
+                    if (n < 0 && errno == EINTR) n = 1;
+                    else if (n > 0) client->input.append(buffer, (size_t)n);
+                    string &input = client->input;
+                    size_t begin = 0, newline;
+                    bool tooLong = false;
+                    while ((newline = input.find('\n', begin)) != string::npos) {
+                        string line = input.substr(begin, newline - begin);
+                        begin = newline + 1;
+                        if (line.size() > SERVER_MAX_REQUEST_BYTES) {
+                            tooLong = true;
+                            break;
+                        }
+                        if (!line.empty() && line.back() == '\r') line.pop_back();
+                        if (!line.empty()) submit(client, move(line));
+                    }
+                    input.erase(0, begin);
+                    // A COMPLETE LINE OR THE UNFINISHED REST, WHICHEVER IS TOO LONG, ENDS THE CONNECTION
+                    if (tooLong || input.size() > SERVER_MAX_REQUEST_BYTES) {
+                        reply(client, errorLine("REQUEST LINE TOO LONG"));
+                        n = 0;
+                    } else if (n == 0 && !input.empty()) {
+                        submit(client, move(input));  // LAST LINE WITHOUT A NEWLINE
+                    }
+                    open = n > 0;
+                }
+                // A CLOSED CLIENT STAYS ALIVE IN THE POOL'S TASKS UNTIL ITS LAST RESPONSE IS WRITTEN
+                if (open) clients[kept++] = move(client);
+            }
+            clients.resize(kept);
+
+            if (fds[1].revents & POLLIN) {
+                int fd = accept(listenFd, nullptr, nullptr);
+                if (fd >= 0 && clients.size() >= SERVER_MAX_CLIENTS) {
+                    string line = errorLine("TOO MANY CLIENTS") + "\n";
+                    ssize_t written = write(fd, line.data(), line.size());
+                    (void)written;
+                    close(fd);
+                } else if (fd >= 0) {
+                    timeval timeout{SERVER_WRITE_TIMEOUT_SECONDS, 0};
+                    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                    clients.push_back(make_shared<Connection>(fd));
+                    ++accepted;
+                }
+            }
+        }
+
+        // GRACEFUL SHUTDOWN: NO NEW CLIENTS OR REQUESTS, BUT EVERY QUEUED QUERY IS ANSWERED
+        cout << "\nSHUTTING DOWN, FINISHING QUEUED QUERIES" << endl;
+        close(listenFd);
+        if (!options.socketPath.empty()) unlink(options.socketPath.c_str());
+        clients.clear();
+        pool.wait();
+    }
+
+    sigaction(SIGINT, &oldInt, nullptr);
+    sigaction(SIGTERM, &oldTerm, nullptr);
+    sigaction(SIGPIPE, &oldPipe, nullptr);
+    close(wakePipe[0]);
+    close(wakePipe[1]);
+
+    cout << "SERVED " << served.load() << " QUERIES ON " << accepted << " CONNECTIONS\n";
+    printCacheStats(cache.get(), postingCache.get());
+    return true;
+}
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef _QUERY_SERVER_H_
+#define _QUERY_SERVER_H_
+
+#include <cstddef>
+#include <string>
+#include "batch_query.h"
+#include "binary_index.h"
+#include "doc_table.h"
+
+// LONGEST REQUEST LINE A CLIENT MAY SEND; A LONGER ONE GETS AN ERROR AND THE CONNECTION IS CLOSED
+static const size_t SERVER_MAX_REQUEST_BYTES = 64 << 10;
+// CONNECTIONS BEYOND THIS ARE REFUSED
+static const size_t SERVER_MAX_CLIENTS = 256;
+// A CLIENT THAT ACCEPTS NO RESPONSE BYTES FOR THIS LONG IS GIVEN UP ON, SO IT CANNOT HOLD A WORKER
+// (OR A SHUTDOWN) FOREVER
+static const int SERVER_WRITE_TIMEOUT_SECONDS = 30;
+
+struct ServerOptions {
+    std::string socketPath;   // UNIX DOMAIN SOCKET TO LISTEN ON
+    int tcpPort = 0;          // OR, WHEN socketPath IS EMPTY, THIS PORT ON 127.0.0.1
+    size_t numThreads = 1;
+    size_t shards = 1;        // > 1: SPLIT EACH FULL UNRANKED QUERY INTO UP TO shards DOC RANGES (sharded_query.h)
+    ResultMode mode;          // DEFAULT MODE; A JSON REQUEST CAN OVERRIDE IT
+    size_t cacheBytes = 0;    // RESULT CACHE BUDGET; 0 DISABLES THE CACHE
+    size_t postingCacheBytes = 0;  // DECODED POSTING CACHE BUDGET; 0 DISABLES IT
+    const IndexReader *biwords = nullptr;  // OPTIONAL BIWORD INDEX OF THE SAME BUILD
+};
+
+// LONG-RUNNING QUERY SERVER (POSIX ONLY). EVERY REQUEST IS ONE LINE: THE QUERY TEXT, OR A JSON
+// OBJECT {"query": "...", "top": K, "first": N, "count": true} (ALL BUT "query" OPTIONAL). EVERY
+// RESPONSE IS ONE JSON LINE AS WRITTEN BY answerQuery.
+//
+// ONE THREAD POLLS THE LISTENING SOCKET AND THE CLIENTS AND HANDS COMPLETE LINES TO A FIXED
+// WORKER POOL THAT SHARES THE MAPPED INDEX AND BOTH CACHES. CLIENTS MAY PIPELINE: REQUESTS OF
+// ONE CONNECTION RUN CONCURRENTLY BUT THEIR RESPONSES COME BACK IN REQUEST ORDER. SIGINT /
+// SIGTERM STOP ACCEPTING AND READING, FINISH THE QUERIES ALREADY RECEIVED, DELIVER THEIR
+// RESPONSES AND RETURN
+bool runQueryServer(const IndexReader &index, const DocTable &docTable, const ServerOptions &options);
+
+#endif
@@ -0,0 +1,212 @@
+#include "ranking.h"
+#include "fuzzy.h"
+#include "query_engine.h"
+#include "wildcard.h"
+#include <algorithm>
+#include <memory>
+#include <queue>
+
+using namespace std;
+
+namespace {
+
+// WORSE RESULT FIRST: LOWER SCORE, OR ON A TIE THE HIGHER DOC ID
+struct WorseFirst {
+    bool operator()(const ScoredDoc &a, const ScoredDoc &b) const {
+        return a.score != b.score ? a.score > b.score : a.docId < b.docId;
+    }
+};
+
+// BOUNDED MIN-HEAP OF THE BEST k RESULTS. DOCS ARRIVE IN ASCENDING ID ORDER, SO A NEW DOC
+// WITH THE SAME SCORE AS THE K-TH IS NEVER BETTER AND ONLY A STRICTLY HIGHER SCORE GETS IN
+class TopK {
+public:
+    explicit TopK(size_t k) : k_(k) {}
+
+    // A DOC MUST SCORE ABOVE THIS TO ENTER
+    float threshold() const { return heap_.size() < k_ ? 0.0f : heap_.top().score; }
+
+    void offer(int docId, float score) {
+        if (heap_.size() < k_) {
+            heap_.push({docId, score});
+        } else if (score > heap_.top().score) {
+            heap_.pop();
+            heap_.push({docId, score});
+        }
+    }
+
+    vector<ScoredDoc> take() {
+        vector<ScoredDoc> out;
+        while (!heap_.empty()) {
+            out.push_back(heap_.top());
+            heap_.pop();
+        }
+        reverse(out.begin(), out.end());
+        return out;
+    }
+
+private:
+    size_t k_;
+    priority_queue<ScoredDoc, vector<ScoredDoc>, WorseFirst> heap_;
+};
+
+struct ScoredTerm {
+    unique_ptr<BlockCursor> cursor;
+    float idf;
+    float maxScore;  // TERM UPPER BOUND WITH SLACK
+};
+
+vector<ScoredTerm> openTerms(const IndexReader &index, const Bm25 &bm25, const vector<int> &termIds,
+                             RankStats &stats) {
+    vector<ScoredTerm> out;
+    for (int id : termIds) {
+        ScoredTerm st;
+        st.cursor = make_unique<BlockCursor>(index, id);
+        st.idf = bm25.idf(st.cursor->df());
+        st.maxScore = st.cursor->maxScore() * SCORE_BOUND_SLACK;
+        stats.blocksTotal += st.cursor->blockCount();
+        out.push_back(move(st));
+    }
+    return out;
+}
+
+// TOKENS OF EVERY TERM / PHRASE / NEAR NODE OUTSIDE A NOT, AND THE TERMS EVERY WILDCARD / FUZZY
+// TERM EXPANDS TO
+void collectPositiveTerms(const IndexReader &index, const QueryNode &node, vector<string> &out) {
+    if (node.type == QueryNodeType::NOT) return;
+    if (node.type == QueryNodeType::WILDCARD || node.type == QueryNodeType::FUZZY) {
+        TermExpansion expansion = node.type == QueryNodeType::WILDCARD
+            ? expandWildcard(index, node.tokens[0].first)
+            : expandFuzzy(index, node.tokens[0].first, node.slop);
+        for (int termId : expansion.termIds) out.emplace_back(index.term(termId));
+        return;
+    }
+    for (const auto &token : node.tokens) out.push_back(token.first);
+    for (const auto &child : node.children) collectPositiveTerms(index, *child, out);
+}
+
+// A WILDCARD OR FUZZY TERM IS AN OR OF ITS EXPANSIONS
+bool isBagOfWords(const QueryNode &query) {
+    auto isWord = [](const QueryNode &node) {
+        return node.type == QueryNodeType::TERM || node.type == QueryNodeType::WILDCARD ||
+               node.type == QueryNodeType::FUZZY;
+    };
+    if (isWord(query)) return true;
+    if (query.type != QueryNodeType::OR) return false;
+    for (const auto &child : query.children) {
+        if (!isWord(*child)) return false;
+    }
+    return true;
+}
+
+// BLOCK-MAX WAND (DING & SUEL). CURSORS ARE KEPT SORTED BY DOC; THE PIVOT IS THE FIRST CURSOR
+// WHERE THE SUMMED TERM MAXIMA EXCEED THE THRESHOLD. THE PIVOT DOC IS THEN CHECKED AGAINST THE
+// SUMMED BLOCK MAXIMA OF THE BLOCKS THAT WOULD HOLD IT: IF EVEN THOSE CANNOT BEAT THE THRESHOLD,
+// EVERY CURSOR UP TO THE PIVOT JUMPS PAST THE NEAREST OF THOSE BLOCK BOUNDARIES UNDECODED
+vector<ScoredDoc> blockMaxWand(const IndexReader &index, vector<ScoredTerm> &terms, size_t k, RankStats &stats) {
+    Bm25 bm25(index.totalDocLength(), (uint32_t)index.maxDocId());
+    TopK top(k);
+    vector<ScoredTerm *> order;
+    for (ScoredTerm &t : terms) order.push_back(&t);
+    auto byDoc = [](const ScoredTerm *a, const ScoredTerm *b) { return a->cursor->doc() < b->cursor->doc(); };
+
+    while (true) {
+        sort(order.begin(), order.end(), byDoc);
+        float threshold = top.threshold();
+
+        size_t pivot = order.size();
+        float bound = 0.0f;
+        for (size_t i = 0; i < order.size() && order[i]->cursor->doc() != END_DOC; ++i) {
+            bound += order[i]->maxScore;
+            if (bound > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == order.size()) break;
+        int pivotDoc = order[pivot]->cursor->doc();
+        while (pivot + 1 < order.size() && order[pivot + 1]->cursor->doc() == pivotDoc) ++pivot;
+
+        float blockBound = 0.0f;
+        for (size_t i = 0; i <= pivot; ++i) {
+            order[i]->cursor->shallowAdvance(pivotDoc);
+            blockBound += order[i]->cursor->shallowMaxScore() * SCORE_BOUND_SLACK;
+        }
+
+        if (blockBound > threshold) {
+            if (order[0]->cursor->doc() == pivotDoc) {
+                // SUM IN QUERY-TERM ORDER SO A DOC'S SCORE DOES NOT DEPEND ON THE CURSOR ORDER
+                float score = 0.0f;
+                uint32_t length = index.docLength(pivotDoc);
+                for (ScoredTerm &t : terms) {
+                    if (t.cursor->doc() != pivotDoc) continue;
+                    score += bm25.termScore(t.idf, t.cursor->tf(), length);
+                    t.cursor->next();
+                }
+                ++stats.docsScored;
+                top.offer(pivotDoc, score);
+            } else {
+                for (size_t i = 0; i < pivot && order[i]->cursor->doc() < pivotDoc; ++i) {
+                    order[i]->cursor->advance(pivotDoc);
+                }
+            }
+        } else {
+            // NO DOC BEFORE THE END OF THE FIRST-ENDING BLOCK (OR THE NEXT CURSOR) CAN QUALIFY
+            int nextDoc = pivot + 1 < order.size() ? order[pivot + 1]->cursor->doc() : END_DOC;
+            for (size_t i = 0; i <= pivot; ++i) {
+                int last = order[i]->cursor->shallowLastDoc();
+                if (last != END_DOC) nextDoc = min(nextDoc, last + 1);
+            }
+            for (size_t i = 0; i <= pivot; ++i) order[i]->cursor->advance(nextDoc);
+        }
+    }
+
+    for (const ScoredTerm &t : terms) stats.blocksDecoded += t.cursor->blocksDecoded();
+    return top.take();
+}
+
+// SCORE EVERY MATCH OF THE ITERATOR TREE
+vector<ScoredDoc> scoreMatches(const IndexReader &index, const QueryNode &query, vector<ScoredTerm> &terms,
+                               size_t k, RankStats &stats, PostingCache *cache, const IndexReader *biwords) {
+    Bm25 bm25(index.totalDocLength(), (uint32_t)index.maxDocId());
+    TopK top(k);
+    QueryContext ctx(index, cache, biwords);
+    unique_ptr<DocIterator> it = buildIterator(query, ctx);
+    for (; it->doc() != END_DOC; it->next()) {
+        int doc = it->doc();
+        uint32_t length = index.docLength(doc);
+        float score = 0.0f;
+        for (ScoredTerm &t : terms) {
+            t.cursor->advance(doc);
+            if (t.cursor->doc() == doc) score += bm25.termScore(t.idf, t.cursor->tf(), length);
+        }
+        ++stats.docsScored;
+        top.offer(doc, score);
+    }
+    for (const ScoredTerm &t : terms) stats.blocksDecoded += t.cursor->blocksDecoded();
+    return top.take();
+}
+
+} // namespace
+
+vector<int> positiveTermIds(const IndexReader &index, const QueryNode &query) {
+    vector<string> words;
+    collectPositiveTerms(index, query, words);
+    vector<int> ids;
+    for (const string &word : words) {
+        int id = index.findTerm(word);
+        if (id >= 0 && find(ids.begin(), ids.end(), id) == ids.end()) ids.push_back(id);
+    }
+    return ids;
+}
+
+vector<ScoredDoc> executeRankedQuery(const IndexReader &index, const QueryNode &query, size_t k, RankStats &stats,
+                                     PostingCache *cache, const IndexReader *biwords) {
+    stats = RankStats();
+    if (k == 0) return {};
+    Bm25 bm25(index.totalDocLength(), (uint32_t)index.maxDocId());
+    vector<ScoredTerm> terms = openTerms(index, bm25, positiveTermIds(index, query), stats);
+
+    if (isBagOfWords(query)) return blockMaxWand(index, terms, k, stats);
+    return scoreMatches(index, query, terms, k, stats, cache, biwords);
+}
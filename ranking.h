@@ -0,0 +1,66 @@
+#ifndef _RANKING_H_
+#define _RANKING_H_
+
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "binary_index.h"
+#include "posting_cache.h"
+#include "query_parser.h"
+
+// BM25 PARAMETERS. THE BLOCK-MAX BOUNDS STORED IN THE BINARY INDEX ARE COMPUTED WITH THESE,
+// SO CHANGING THEM REQUIRES REBUILDING THE INDEX
+static const float BM25_K1 = 1.2f;
+static const float BM25_B = 0.75f;
+
+// UPPER BOUNDS ARE INFLATED BY THIS FACTOR BEFORE BEING COMPARED WITH THE THRESHOLD, SO FLOAT
+// ROUNDING IN A SUM OF BOUNDS CAN NEVER PRUNE A DOC THAT WOULD HAVE MADE THE TOP K
+static const float SCORE_BOUND_SLACK = 1.0001f;
+
+// BM25 SCORER. THE SAME CODE RUNS WHEN THE INDEX WRITER COMPUTES THE STORED MAXIMA AND WHEN
+// QUERIES ARE SCORED, SO A STORED MAXIMUM IS EXACTLY THE LARGEST SCORE THE QUERY CAN SEE
+class Bm25 {
+public:
+    Bm25(uint64_t totalDocLength, uint32_t docCount)
+        : docCount_(docCount),
+          avgDocLength_(docCount > 0 && totalDocLength > 0 ? (float)((double)totalDocLength / docCount) : 1.0f) {}
+
+    float idf(uint32_t df) const {
+        return std::log(1.0f + ((float)docCount_ - (float)df + 0.5f) / ((float)df + 0.5f));
+    }
+    float termScore(float idf, uint32_t tf, uint32_t docLength) const {
+        float norm = BM25_K1 * (1.0f - BM25_B + BM25_B * (float)docLength / avgDocLength_);
+        return idf * ((float)tf * (BM25_K1 + 1.0f)) / ((float)tf + norm);
+    }
+
+private:
+    uint32_t docCount_;
+    float avgDocLength_;
+};
+
+struct ScoredDoc {
+    int docId;
+    float score;
+};
+
+struct RankStats {
+    size_t docsScored = 0;     // DOCS WHOSE FULL SCORE WAS COMPUTED
+    size_t blocksDecoded = 0;  // POSTING BLOCKS DECODED BY THE SCORING CURSORS
+    size_t blocksTotal = 0;    // POSTING BLOCKS OF ALL QUERY TERMS
+};
+
+// THE DISTINCT INDEXED TERMS A QUERY IS SCORED ON, IN QUERY ORDER: EVERY TOKEN OUTSIDE A NOT AND
+// THE EXPANSIONS OF EVERY WILDCARD / FUZZY TERM
+std::vector<int> positiveTermIds(const IndexReader &index, const QueryNode &query);
+
+// TOP k DOCS OF A PARSED QUERY BY BM25, BEST FIRST (EQUAL SCORES: LOWER DOC ID FIRST).
+// A TERM OR AN OR OF TERMS (WILDCARD / FUZZY TERMS COUNT AS THE OR OF THEIR EXPANSIONS) IS A
+// BAG-OF-WORDS QUERY AND RUNS BLOCK-MAX WAND, WHICH SKIPS EVERY BLOCK WHOSE STORED MAXIMA CANNOT
+// BEAT THE CURRENT K-TH SCORE. ANY OTHER QUERY IS MATCHED BY THE ITERATOR TREE AND EACH MATCH IS
+// SCORED BY THE NON-NEGATED TERMS IT CONTAINS
+std::vector<ScoredDoc> executeRankedQuery(const IndexReader &index, const QueryNode &query, size_t k,
+                                          RankStats &stats, PostingCache *cache = nullptr,
+                                          const IndexReader *biwords = nullptr);
+
+#endif
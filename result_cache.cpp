@@ -0,0 +1,85 @@
+#include "result_cache.h"
+#include <algorithm>
+
+using namespace std;
+
+// ROUGH PER-ENTRY OVERHEAD OF THE LIST NODE, HASH NODE AND TWO KEY COPIES
+static const size_t CACHE_ENTRY_OVERHEAD = 128;
+
+// EXPECTED AVERAGE ENTRY SIZE, USED TO SIZE THE FREQUENCY SKETCH
+static const size_t CACHE_SKETCH_BYTES_PER_ITEM = 512;
+
+ResultCache::ResultCache(size_t capacityBytes)
+    : capacityBytes_(capacityBytes),
+      sketch_(min<size_t>(1 << 20, max<size_t>(1024, capacityBytes / CACHE_SKETCH_BYTES_PER_ITEM))) {}
+
+void ResultCache::checkGeneration(uint64_t generation) {
+    if (generation == generation_) return;
+    if (!lru_.empty()) stats_.invalidations++;
+    lru_.clear();
+    map_.clear();
+    stats_.entries = 0;
+    stats_.bytes = 0;
+    generation_ = generation;
+}
+
+void ResultCache::evictBack() {
+    stats_.bytes -= lru_.back().bytes;
+    map_.erase(lru_.back().key);
+    lru_.pop_back();
+    stats_.entries--;
+    stats_.evictions++;
+}
+
+bool ResultCache::lookup(const string &key, uint64_t generation, vector<ScoredDoc> &results) {
+    lock_guard<mutex> lock(mutex_);
+    checkGeneration(generation);
+    sketch_.increment(FrequencySketch::hashKey(key));
+    auto it = map_.find(key);
+    if (it == map_.end()) {
+        stats_.misses++;
+        return false;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    results = it->second->results;
+    stats_.hits++;
+    return true;
+}
+
+void ResultCache::insert(const string &key, uint64_t generation, const vector<ScoredDoc> &results) {
+    size_t bytes = 2 * key.size() + results.size() * sizeof(ScoredDoc) + CACHE_ENTRY_OVERHEAD;
+    lock_guard<mutex> lock(mutex_);
+    checkGeneration(generation);
+    if (map_.count(key)) return;  // ANOTHER THREAD GOT THERE FIRST
+    if (bytes > capacityBytes_) {
+        stats_.rejected++;
+        return;
+    }
+
+    uint32_t frequency = sketch_.estimate(FrequencySketch::hashKey(key));
+    while (stats_.bytes + bytes > capacityBytes_) {
+        if (frequency <= sketch_.estimate(FrequencySketch::hashKey(lru_.back().key))) {
+            stats_.rejected++;
+            return;
+        }
+        evictBack();
+    }
+
+    lru_.push_front({key, results, bytes});
+    map_[key] = lru_.begin();
+    stats_.entries++;
+    stats_.bytes += bytes;
+    stats_.inserts++;
+}
+
+ResultCacheStats ResultCache::stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
+
+string resultCacheKey(const QueryNode &query, size_t topK, size_t firstN) {
+    string mode = topK > 0 ? "TOP" + to_string(topK) + " "
+                : firstN > 0 ? "FIRST" + to_string(firstN) + " "
+                : string("ALL ");
+    return mode + describeQuery(query);
+}
@@ -0,0 +1,63 @@
+#ifndef _RESULT_CACHE_H_
+#define _RESULT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "frequency_sketch.h"
+#include "ranking.h"
+
+struct ResultCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t inserts = 0;
+    uint64_t rejected = 0;       // NEW ENTRIES REFUSED BY THE FREQUENCY FILTER (OR TOO LARGE)
+    uint64_t evictions = 0;
+    uint64_t invalidations = 0;  // TIMES THE WHOLE CACHE WAS DROPPED FOR A NEW INDEX GENERATION
+    size_t entries = 0;
+    size_t bytes = 0;
+
+    double hitRate() const { return hits + misses > 0 ? (double)hits / (double)(hits + misses) : 0.0; }
+};
+
+// QUERY RESULT CACHE SHARED BY QUERY THREADS. KEYS ARE NORMALIZED QUERIES (SEE resultCacheKey);
+// ENTRIES ARE BOUNDED BY AN APPROXIMATE BYTE BUDGET. EVICTION IS LRU, AND ADMISSION IS TINYLFU: WHEN
+// THE CACHE IS FULL A NEW ENTRY ONLY REPLACES THE LRU VICTIM IF IT HAS BEEN LOOKED UP MORE OFTEN.
+// ALL CACHED RESULTS BELONG TO ONE INDEX GENERATION; USING ANOTHER GENERATION CLEARS THE CACHE
+class ResultCache {
+public:
+    explicit ResultCache(size_t capacityBytes);
+
+    bool lookup(const std::string &key, uint64_t generation, std::vector<ScoredDoc> &results);
+    void insert(const std::string &key, uint64_t generation, const std::vector<ScoredDoc> &results);
+    ResultCacheStats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::vector<ScoredDoc> results;
+        size_t bytes;
+    };
+
+    // CALLERS HOLD mutex_
+    void checkGeneration(uint64_t generation);
+    void evictBack();
+
+    size_t capacityBytes_;
+    uint64_t generation_ = 0;
+    std::list<Entry> lru_;  // MOST RECENTLY USED FIRST
+    std::unordered_map<std::string, std::list<Entry>::iterator> map_;
+    FrequencySketch sketch_;
+    ResultCacheStats stats_;
+    mutable std::mutex mutex_;
+};
+
+// CACHE KEY OF A PARSED QUERY: ITS CANONICAL FORM (STEMMED, LOWERCASED, STOP WORDS DROPPED, SO
+// CASE, PUNCTUATION AND INFLECTION VARIANTS COLLIDE) PLUS THE RESULT MODE
+std::string resultCacheKey(const QueryNode &query, size_t topK, size_t firstN = 0);
+
+#endif
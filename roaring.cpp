@@ -0,0 +1,262 @@
+#include "roaring.h"
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+static inline int popcount64(uint64_t v) {
+#ifdef _MSC_VER
+    return (int)__popcnt64(v);
+#else
+    return __builtin_popcountll(v);
+#endif
+}
+
+static inline int lowestBit64(uint64_t v) {
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward64(&idx, v);
+    return (int)idx;
+#else
+    return __builtin_ctzll(v);
+#endif
+}
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (isBitmap()) return (bits[low >> 6] >> (low & 63)) & 1;
+    return binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::normalize() {
+    if (isBitmap() && cardinality <= ROARING_ARRAY_MAX) {
+        array.clear();
+        array.reserve(cardinality);
+        for (size_t w = 0; w < ROARING_BITMAP_WORDS; ++w) {
+            for (uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                array.push_back((uint16_t)(w * 64 + lowestBit64(word)));
+            }
+        }
+        bits.clear();
+        bits.shrink_to_fit();
+    } else if (!isBitmap() && cardinality > ROARING_ARRAY_MAX) {
+        bits.assign(ROARING_BITMAP_WORDS, 0);
+        for (uint16_t low : array) bits[low >> 6] |= uint64_t(1) << (low & 63);
+        array.clear();
+        array.shrink_to_fit();
+    }
+}
+
+void RoaringBitmap::append(Container container) {
+    if (container.cardinality == 0) return;
+    cardinality_ += container.cardinality;
+    containers_.push_back(move(container));
+}
+
+RoaringBitmap::RoaringBitmap(const int *docs, size_t count) {
+    size_t i = 0;
+    while (i < count) {
+        Container container;
+        container.key = (uint16_t)((uint32_t)docs[i] >> 16);
+        for (; i < count && (uint32_t)docs[i] >> 16 == container.key; ++i) {
+            container.array.push_back((uint16_t)(docs[i] & 0xFFFF));
+        }
+        container.cardinality = (uint32_t)container.array.size();
+        container.normalize();
+        append(move(container));
+    }
+}
+
+bool RoaringBitmap::contains(int doc) const {
+    uint16_t key = (uint16_t)((uint32_t)doc >> 16);
+    auto it = lower_bound(containers_.begin(), containers_.end(), key,
+                          [](const Container &c, uint16_t k) { return c.key < k; });
+    return it != containers_.end() && it->key == key && it->contains((uint16_t)(doc & 0xFFFF));
+}
+
+void RoaringBitmap::toList(vector<int> &out) const {
+    out.reserve(out.size() + cardinality_);
+    for (Cursor cursor(*this); cursor.doc() != INT_MAX; cursor.next()) out.push_back(cursor.doc());
+}
+
+void RoaringBitmap::serialize(string &out) const {
+    size_t start = out.size();
+    uint32_t counts[2] = {(uint32_t)containers_.size(), (uint32_t)cardinality_};
+    out.append(reinterpret_cast<const char *>(counts), sizeof(counts));
+    size_t headersStart = out.size();
+    out.resize(headersStart + containers_.size() * sizeof(RoaringContainerHeader));
+
+    for (size_t c = 0; c < containers_.size(); ++c) {
+        const Container &container = containers_[c];
+        RoaringContainerHeader header{};
+        header.key = container.key;
+        header.isBitmap = container.isBitmap() ? 1 : 0;
+        header.cardinality = container.cardinality;
+        header.offset = (uint32_t)(out.size() - start);
+        memcpy(&out[headersStart + c * sizeof(RoaringContainerHeader)], &header, sizeof(header));
+        if (container.isBitmap()) {
+            out.append(reinterpret_cast<const char *>(container.bits.data()), ROARING_BITMAP_WORDS * sizeof(uint64_t));
+        } else {
+            out.append(reinterpret_cast<const char *>(container.array.data()), container.array.size() * sizeof(uint16_t));
+        }
+    }
+}
+
+bool RoaringBitmap::deserialize(const char *data, size_t size) {
+    containers_.clear();
+    cardinality_ = 0;
+    uint32_t counts[2];
+    if (size < sizeof(counts)) return false;
+    memcpy(counts, data, sizeof(counts));
+    size_t headersEnd = sizeof(counts) + (size_t)counts[0] * sizeof(RoaringContainerHeader);
+    if (headersEnd > size) return false;
+
+    containers_.reserve(counts[0]);
+    for (uint32_t c = 0; c < counts[0]; ++c) {
+        RoaringContainerHeader header;
+        memcpy(&header, data + sizeof(counts) + c * sizeof(header), sizeof(header));
+        size_t bytes = header.isBitmap ? ROARING_BITMAP_WORDS * sizeof(uint64_t) : header.cardinality * sizeof(uint16_t);
+        if (header.cardinality == 0 || header.cardinality > 65536 || header.offset < headersEnd ||
+            header.offset + bytes > size || (!containers_.empty() && header.key <= containers_.back().key)) {
+            containers_.clear();
+            cardinality_ = 0;
+            return false;
+        }
+        Container container;
+        container.key = header.key;
+        container.cardinality = header.cardinality;
+        if (header.isBitmap) {
+            container.bits.resize(ROARING_BITMAP_WORDS);
+            memcpy(container.bits.data(), data + header.offset, bytes);
+        } else {
+            container.array.resize(header.cardinality);
+            memcpy(container.array.data(), data + header.offset, bytes);
+        }
+        append(move(container));
+    }
+    return cardinality_ == counts[1];
+}
+
+void RoaringBitmap::Cursor::advance(int target) {
+    if (target <= doc_) return;
+    const auto &containers = set_->containers_;
+    uint16_t key = (uint16_t)((uint32_t)target >> 16);
+    size_t c = container_;
+    while (c < containers.size() && containers[c].key < key) ++c;
+    seek(c, c < containers.size() && containers[c].key == key ? (uint32_t)(target & 0xFFFF) : 0);
+}
+
+void RoaringBitmap::Cursor::seek(size_t c, uint32_t low) {
+    const auto &containers = set_->containers_;
+    for (; c < containers.size(); ++c, low = 0) {
+        const Container &container = containers[c];
+        if (low > 0xFFFF) continue;
+        if (container.isBitmap()) {
+            size_t w = low >> 6;
+            uint64_t word = container.bits[w] & (~uint64_t(0) << (low & 63));
+            while (word == 0 && ++w < ROARING_BITMAP_WORDS) word = container.bits[w];
+            if (word == 0) continue;
+            container_ = c;
+            doc_ = (int)(((uint32_t)container.key << 16) | (uint32_t)(w * 64 + lowestBit64(word)));
+            return;
+        }
+        // ARRAYS ARE SEARCHED FROM THE CURRENT POSITION WHEN STAYING IN THE SAME CONTAINER
+        size_t from = c == container_ && doc_ != INT_MAX ? index_ : 0;
+        auto it = lower_bound(container.array.begin() + from, container.array.end(), (uint16_t)low);
+        if (it == container.array.end()) continue;
+        container_ = c;
+        index_ = (size_t)(it - container.array.begin());
+        doc_ = (int)(((uint32_t)container.key << 16) | *it);
+        return;
+    }
+    container_ = containers.size();
+    doc_ = INT_MAX;
+}
+
+size_t intersectListBitmap(const int *list, size_t count, const RoaringBitmap &set, int *out) {
+    const auto &containers = set.containers_;
+    size_t kept = 0, c = 0;
+    for (size_t i = 0; i < count && c < containers.size(); ++i) {
+        int doc = list[i];
+        uint16_t key = (uint16_t)((uint32_t)doc >> 16);
+        while (c < containers.size() && containers[c].key < key) ++c;
+        if (c < containers.size() && containers[c].key == key && containers[c].contains((uint16_t)(doc & 0xFFFF))) {
+            out[kept++] = doc;
+        }
+    }
+    return kept;
+}
+
+RoaringBitmap intersectBitmaps(const RoaringBitmap &a, const RoaringBitmap &b) {
+    using Container = RoaringBitmap::Container;
+    RoaringBitmap result;
+    size_t i = 0, j = 0;
+    while (i < a.containers_.size() && j < b.containers_.size()) {
+        const Container &x = a.containers_[i], &y = b.containers_[j];
+        if (x.key < y.key) { ++i; continue; }
+        if (y.key < x.key) { ++j; continue; }
+        Container both;
+        both.key = x.key;
+        if (x.isBitmap() && y.isBitmap()) {
+            both.bits.resize(ROARING_BITMAP_WORDS);
+            for (size_t w = 0; w < ROARING_BITMAP_WORDS; ++w) {
+                both.bits[w] = x.bits[w] & y.bits[w];
+                both.cardinality += popcount64(both.bits[w]);
+            }
+        } else if (x.isBitmap() || y.isBitmap()) {
+            const Container &array = x.isBitmap() ? y : x, &bitmap = x.isBitmap() ? x : y;
+            for (uint16_t low : array.array) {
+                if (bitmap.contains(low)) both.array.push_back(low);
+            }
+            both.cardinality = (uint32_t)both.array.size();
+        } else {
+            set_intersection(x.array.begin(), x.array.end(), y.array.begin(), y.array.end(),
+                             back_inserter(both.array));
+            both.cardinality = (uint32_t)both.array.size();
+        }
+        both.normalize();
+        result.append(move(both));
+        ++i;
+        ++j;
+    }
+    return result;
+}
+
+RoaringBitmap unionBitmaps(const RoaringBitmap &a, const RoaringBitmap &b) {
+    using Container = RoaringBitmap::Container;
+    RoaringBitmap result;
+    size_t i = 0, j = 0;
+    while (i < a.containers_.size() || j < b.containers_.size()) {
+        if (j == b.containers_.size() || (i < a.containers_.size() && a.containers_[i].key < b.containers_[j].key)) {
+            result.append(a.containers_[i++]);
+            continue;
+        }
+        if (i == a.containers_.size() || b.containers_[j].key < a.containers_[i].key) {
+            result.append(b.containers_[j++]);
+            continue;
+        }
+        const Container &x = a.containers_[i++], &y = b.containers_[j++];
+        Container either;
+        either.key = x.key;
+        if (x.isBitmap() || y.isBitmap()) {
+            const Container &bitmap = x.isBitmap() ? x : y, &other = x.isBitmap() ? y : x;
+            either.bits = bitmap.bits;
+            if (other.isBitmap()) {
+                for (size_t w = 0; w < ROARING_BITMAP_WORDS; ++w) either.bits[w] |= other.bits[w];
+            } else {
+                for (uint16_t low : other.array) either.bits[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+            for (uint64_t word : either.bits) either.cardinality += popcount64(word);
+        } else {
+            set_union(x.array.begin(), x.array.end(), y.array.begin(), y.array.end(), back_inserter(either.array));
+            either.cardinality = (uint32_t)either.array.size();
+            either.normalize();
+        }
+        result.append(move(either));
+    }
+    return result;
+}
@@ -0,0 +1,109 @@
+#ifndef _ROARING_H_
+#define _ROARING_H_
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ROARING-STYLE COMPRESSED DOC SET FOR DENSE TERMS
+//
+// DOC IDS ARE SPLIT BY THEIR HIGH 16 BITS INTO CONTAINERS OF UP TO 65536 DOCS. A CONTAINER HOLDING AT
+// MOST ROARING_ARRAY_MAX DOCS IS A SORTED uint16_t ARRAY, A FULLER ONE A 65536-BIT BITMAP, SO A
+// CONTAINER NEVER TAKES MORE THAN 8 KB OR MORE THAN 2 BYTES PER DOC. (NO RUN CONTAINERS: THE DOC SET
+// OF A TERM RARELY HAS LONG RUNS OF CONSECUTIVE IDS.)
+//
+// SERIALIZED FORM (LITTLE-ENDIAN):
+//   uint32_t containerCount, uint32_t cardinality
+//   RoaringContainerHeader[containerCount] BY ASCENDING KEY
+//   CONTAINER DATA: uint16_t[cardinality] FOR AN ARRAY, uint64_t[ROARING_BITMAP_WORDS] FOR A BITMAP
+
+static const size_t ROARING_ARRAY_MAX = 4096;
+static const size_t ROARING_BITMAP_WORDS = 1024;
+
+struct RoaringContainerHeader {
+    uint16_t key;          // HIGH 16 BITS OF ITS DOC IDS
+    uint16_t isBitmap;     // 1: BITMAP CONTAINER, 0: ARRAY CONTAINER
+    uint32_t cardinality;
+    uint32_t offset;       // OF ITS DATA, FROM THE START OF THE SERIALIZED SET
+};
+
+class RoaringBitmap {
+public:
+    RoaringBitmap() = default;
+    // FROM SORTED, UNIQUE, NON-NEGATIVE DOC IDS
+    RoaringBitmap(const int *docs, size_t count);
+
+    size_t cardinality() const { return cardinality_; }
+    bool contains(int doc) const;
+    // ALL DOC IDS IN ASCENDING ORDER, APPENDED TO out
+    void toList(std::vector<int> &out) const;
+
+    void serialize(std::string &out) const;
+    // FALSE IF data IS NOT A WELL-FORMED SERIALIZED SET
+    bool deserialize(const char *data, size_t size);
+
+    // FORWARD CURSOR; doc() IS INT_MAX (END_DOC) ONCE EXHAUSTED
+    class Cursor {
+    public:
+        explicit Cursor(const RoaringBitmap &set) : set_(&set) { seek(0, 0); }
+        int doc() const { return doc_; }
+        void next() {
+            if (doc_ != INT_MAX) seek(container_, (doc_ & 0xFFFF) + 1);
+        }
+        // MOVE TO THE FIRST DOC >= target
+        void advance(int target);
+
+    private:
+        // FIRST DOC >= low IN CONTAINER c, OR THE FIRST DOC OF A LATER CONTAINER
+        void seek(size_t c, uint32_t low);
+
+        const RoaringBitmap *set_;
+        size_t container_ = 0;
+        size_t index_ = 0;  // POSITION IN AN ARRAY CONTAINER
+        int doc_ = INT_MAX;
+    };
+
+private:
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array;  // ARRAY CONTAINER
+        std::vector<uint64_t> bits;   // BITMAP CONTAINER (EMPTY FOR AN ARRAY)
+
+        bool isBitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        // TURN INTO AN ARRAY OR A BITMAP, WHICHEVER FITS cardinality
+        void normalize();
+    };
+
+    void append(Container container);
+
+    std::vector<Container> containers_;
+    size_t cardinality_ = 0;
+
+    friend size_t intersectListBitmap(const int *list, size_t count, const RoaringBitmap &set, int *out);
+    friend RoaringBitmap intersectBitmaps(const RoaringBitmap &a, const RoaringBitmap &b);
+    friend RoaringBitmap unionBitmaps(const RoaringBitmap &a, const RoaringBitmap &b);
+};
+
+// LIST / BITMAP KERNELS. A LIST IS SORTED, UNIQUE DOC IDS. LIST AND LIST IS intersectSorted (intersect.h),
+// LIST OR LIST THE MIN-HEAP DISJUNCTION OF THE QUERY ENGINE
+
+// KEEP THE DOCS OF list THAT ARE IN set: ONE CONTAINER PROBE PER DOC. WRITES THEM TO out (WHICH MAY
+// ALIAS list) AND RETURNS THEIR COUNT
+size_t intersectListBitmap(const int *list, size_t count, const RoaringBitmap &set, int *out);
+
+// CONTAINER BY CONTAINER: BITMAP AND BITMAP IS A WORD-WISE AND, AN ARRAY AGAINST A BITMAP PROBES THE
+// ARRAY'S DOCS, TWO ARRAYS ARE MERGED
+RoaringBitmap intersectBitmaps(const RoaringBitmap &a, const RoaringBitmap &b);
+
+// WORD-WISE OR OF BITMAP CONTAINERS, ARRAYS SET INTO BITMAPS OR MERGED (AND PROMOTED WHEN TOO FULL)
+RoaringBitmap unionBitmaps(const RoaringBitmap &a, const RoaringBitmap &b);
+
+inline RoaringBitmap unionListBitmap(const int *list, size_t count, const RoaringBitmap &set) {
+    return unionBitmaps(RoaringBitmap(list, count), set);
+}
+
+#endif
@@ -0,0 +1,99 @@
+#include "sharded_query.h"
+#include "async_query.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+using namespace std;
+
+vector<DocRange> shardRanges(const IndexReader &index, const QueryNode &query, size_t shards,
+                             const IndexReader *biwords) {
+    vector<PostingRef> postings;
+    collectPostingRefs(index, biwords, query, postings);
+    const PostingRef *longest = nullptr;
+    size_t blocks = 0;
+    for (const PostingRef &p : postings) {
+        size_t count = (p.index->entry(p.termId).df + POSTING_BLOCK_SIZE - 1) / POSTING_BLOCK_SIZE;
+        if (count > blocks) {
+            blocks = count;
+            longest = &p;
+        }
+    }
+
+    vector<DocRange> ranges;
+    size_t count = min(shards, blocks / SHARD_MIN_BLOCKS);
+    if (count <= 1) {
+        ranges.push_back(DocRange());
+        return ranges;
+    }
+    int first = 0;
+    for (size_t k = 1; k < count; ++k) {
+        int last = longest->index->blockLastDoc(longest->termId, k * blocks / count - 1);
+        ranges.push_back(DocRange{first, last});
+        first = last + 1;
+    }
+    ranges.push_back(DocRange{first, END_DOC});
+    return ranges;
+}
+
+namespace {
+
+// SHARDS ARE CLAIMED IN ORDER BY WHICHEVER THREAD GETS THERE FIRST. A HELPER TASK THAT STARTS AFTER
+// ALL OF THEM ARE CLAIMED RETURNS WITHOUT TOUCHING THE QUERY, WHICH MAY BE GONE BY THEN
+struct ShardRun {
+    vector<DocRange> ranges;
+    vector<vector<int>> results;
+    atomic<size_t> next{0};
+    size_t done = 0;
+    mutex doneMutex;
+    condition_variable finished;
+};
+
+vector<int> runShard(const IndexReader &index, const QueryNode &query, const DocRange &range,
+                     const IndexReader *biwords) {
+    QueryContext ctx(index, nullptr, biwords, range);
+    unique_ptr<DocIterator> it = buildIterator(query, ctx);
+    vector<int> matches;
+    for (it->advance(range.first); it->doc() != END_DOC && it->doc() <= range.last; it->next()) {
+        matches.push_back(it->doc());
+    }
+    return matches;
+}
+
+void claimShards(ShardRun &run, const IndexReader &index, const QueryNode &query, const IndexReader *biwords) {
+    for (size_t i; (i = run.next.fetch_add(1)) < run.ranges.size();) {
+        run.results[i] = runShard(index, query, run.ranges[i], biwords);
+        lock_guard<mutex> lock(run.doneMutex);
+        if (++run.done == run.ranges.size()) run.finished.notify_all();
+    }
+}
+
+} // namespace
+
+vector<int> executeQuerySharded(const IndexReader &index, const QueryNode &query, const ShardOptions &sharding,
+                                PostingCache *cache, const IndexReader *biwords) {
+    if (!sharding.pool || sharding.shards <= 1) return executeQuery(index, query, cache, biwords);
+    auto run = make_shared<ShardRun>();
+    run->ranges = shardRanges(index, query, sharding.shards, biwords);
+    if (run->ranges.size() == 1) return executeQuery(index, query, cache, biwords);
+    run->results.resize(run->ranges.size());
+
+    for (size_t i = 1; i < run->ranges.size(); ++i) {
+        sharding.pool->submit([run, &index, &query, biwords] { claimShards(*run, index, query, biwords); });
+    }
+    claimShards(*run, index, query, biwords);
+    {
+        unique_lock<mutex> lock(run->doneMutex);
+        run->finished.wait(lock, [&run] { return run->done == run->ranges.size(); });
+    }
+
+    vector<int> matches;
+    size_t total = 0;
+    for (const auto &shard : run->results) total += shard.size();
+    matches.reserve(total);
+    for (const auto &shard : run->results) matches.insert(matches.end(), shard.begin(), shard.end());
+    return matches;
+}
@@ -0,0 +1,38 @@
+#ifndef _SHARDED_QUERY_H_
+#define _SHARDED_QUERY_H_
+
+#include <cstddef>
+#include <vector>
+#include "binary_index.h"
+#include "posting_cache.h"
+#include "query_engine.h"
+#include "query_parser.h"
+
+class ThreadPool;
+
+// INTRA-QUERY PARALLELISM FOR UNRANKED QUERIES. THE DOC-ID SPACE IS CUT AT SKIP-BLOCK BOUNDARIES OF THE
+// LONGEST POSTING LIST THE QUERY READS, SO EACH OF ITS BLOCKS IS DECODED BY EXACTLY ONE SHARD (ANY OTHER
+// LIST BY AT MOST ONE EXTRA BLOCK PER CUT). EVERY SHARD RUNS THE WHOLE PLAN OVER ITS OWN RANGE AND THE
+// RESULTS ARE CONCATENATED IN RANGE ORDER
+
+// A SHARD GETS AT LEAST THIS MANY BLOCKS OF THE LONGEST LIST; SHORTER QUERIES ARE NOT WORTH THE HAND-OFF
+static const size_t SHARD_MIN_BLOCKS = 8;
+
+// WHERE AND HOW WIDE TO SPLIT; shards <= 1 OR NO pool RUNS QUERIES WHOLE ON THE CALLING THREAD
+struct ShardOptions {
+    ThreadPool *pool = nullptr;
+    size_t shards = 1;
+};
+
+// UP TO shards CONSECUTIVE RANGES COVERING ALL DOC IDS; A SINGLE WHOLE RANGE WHEN THE LONGEST LIST HAS
+// FEWER THAN SHARD_MIN_BLOCKS BLOCKS PER SHARD
+std::vector<DocRange> shardRanges(const IndexReader &index, const QueryNode &query, size_t shards,
+                                  const IndexReader *biwords = nullptr);
+
+// executeQuery SPLIT BY shardRanges (THE CACHE IS ONLY USED WHEN THE QUERY STAYS WHOLE: A SHARD DECODES
+// JUST ITS RANGE). THE CALLING THREAD RUNS SHARDS TOO AND TAKES OVER ANY THAT NO IDLE WORKER HAS
+// STARTED, SO IT IS SAFE TO CALL FROM A TASK OF THE SAME, POSSIBLY BUSY, POOL
+std::vector<int> executeQuerySharded(const IndexReader &index, const QueryNode &query, const ShardOptions &sharding,
+                                     PostingCache *cache = nullptr, const IndexReader *biwords = nullptr);
+
+#endif
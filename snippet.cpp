@@ -0,0 +1,84 @@
+#include "snippet.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+using namespace std;
+
+vector<int> SnippetBuilder::hitPositions(int docId) {
+    vector<int> hits;
+    for (int termId : termIds_) {
+        auto it = postings_.find(termId);
+        if (it == postings_.end()) {
+            it = postings_.emplace(termId, PostingList()).first;
+            index_.decodePostings(termId, it->second);
+        }
+        const PostingList &list = it->second;
+        auto doc = lower_bound(list.docIds.begin(), list.docIds.end(), docId);
+        if (doc == list.docIds.end() || *doc != docId) continue;
+        size_t i = doc - list.docIds.begin();
+        hits.insert(hits.end(), list.positions.begin() + list.posStarts[i], list.positions.begin() + list.posStarts[i + 1]);
+    }
+    sort(hits.begin(), hits.end());
+    hits.erase(unique(hits.begin(), hits.end()), hits.end());
+    return hits;
+}
+
+string SnippetBuilder::build(int docId, const string &path) {
+    vector<int> hits = hitPositions(docId);
+    offsets_.spans(docId, spans_);
+    int wordCount = (int)spans_.size();
+    while (!hits.empty() && hits.back() >= wordCount) hits.pop_back();
+    if (hits.empty()) return string();
+
+    // WINDOW HOLDING THE MOST HITS (TWO POINTERS OVER THE SORTED HITS), CENTRED ON THEM
+    size_t best = 0, bestCount = 0;
+    for (size_t i = 0, j = 0; i < hits.size(); ++i) {
+        while (j < hits.size() && hits[j] - hits[i] < SNIPPET_WINDOW_WORDS) ++j;
+        if (j - i > bestCount) {
+            best = i;
+            bestCount = j - i;
+        }
+    }
+    int spread = hits[best + bestCount - 1] - hits[best];
+    int from = hits[best] - (SNIPPET_WINDOW_WORDS - 1 - spread) / 2;
+    from = max(0, min(from, wordCount - SNIPPET_WINDOW_WORDS));
+    int to = min(wordCount - 1, from + SNIPPET_WINDOW_WORDS - 1);
+
+    // READ ONLY THE WINDOW'S BYTES
+    uint32_t begin = spans_[from].start, end = spans_[to].end;
+    string text;
+    if (store_) {
+        if (!store_->read(docId, begin, end - begin, text) || text.size() != end - begin) return string();
+    } else {
+        ifstream in(path, ios::binary);
+        if (!in.is_open()) return string();
+        text.assign(end - begin, '\0');
+        in.seekg(begin);
+        if (!in.read(&text[0], (streamsize)text.size())) return string();
+    }
+
+    string out = from > 0 ? "..." : "";
+    for (int w = from; w <= to; ++w) {
+        if (w > from) {
+            // WHAT LIES BETWEEN TWO WORDS (PUNCTUATION, WHITESPACE) WITH WHITESPACE RUNS AS ONE SPACE
+            bool space = false;
+            for (uint32_t b = spans_[w - 1].end; b < spans_[w].start; ++b) {
+                char c = text[b - begin];
+                if (isspace(static_cast<unsigned char>(c))) {
+                    if (!space) out.push_back(' ');
+                    space = true;
+                } else {
+                    out.push_back(c);
+                    space = false;
+                }
+            }
+        }
+        bool hit = binary_search(hits.begin(), hits.end(), w);
+        if (hit) out.push_back('[');
+        out.append(text, spans_[w].start - begin, spans_[w].end - spans_[w].start);
+        if (hit) out.push_back(']');
+    }
+    if (to < wordCount - 1) out += "...";
+    return out;
+}
@@ -0,0 +1,41 @@
+#ifndef _SNIPPET_H_
+#define _SNIPPET_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include "binary_index.h"
+#include "doc_offsets.h"
+#include "doc_store.h"
+
+// WORDS OF CONTEXT IN A SNIPPET WINDOW
+static const int SNIPPET_WINDOW_WORDS = 20;
+
+// RESULT SNIPPETS FROM THE BYTE-OFFSET STREAM: THE QUERY TERMS' POSITIONS IN A DOC COME FROM THE
+// POSTINGS, THEIR BYTES FROM doc_offsets, AND ONLY THE WINDOW ITSELF IS READ, FROM THE DOC STORE IF
+// THERE IS ONE (THE ORIGINAL FILES MAY HAVE MOVED), OTHERWISE FROM THE DOCUMENT FILE
+class SnippetBuilder {
+public:
+    // termIds: THE QUERY TERMS TO HIGHLIGHT (SEE positiveTermIds)
+    SnippetBuilder(const IndexReader &index, const DocOffsets &offsets, std::vector<int> termIds,
+                   const DocStore *store = nullptr)
+        : index_(index), offsets_(offsets), termIds_(std::move(termIds)), store_(store) {}
+
+    // THE WINDOW OF THE DOC WITH THE MOST QUERY TERMS, ON ONE LINE, TERMS IN [BRACKETS] AND "..." WHERE
+    // THE DOC GOES ON. EMPTY IF THE DOC HAS NO OFFSETS, NO QUERY TERM OR CANNOT BE READ
+    std::string build(int docId, const std::string &path);
+
+private:
+    // POSITIONS OF THE QUERY TERMS IN THE DOC, ASCENDING AND DISTINCT
+    std::vector<int> hitPositions(int docId);
+
+    const IndexReader &index_;
+    const DocOffsets &offsets_;
+    std::vector<int> termIds_;
+    const DocStore *store_;
+    std::map<int, PostingList> postings_;  // DECODED ONCE PER TERM, REUSED FOR EVERY RESULT
+    std::vector<TokenSpan> spans_;
+};
+
+#endif
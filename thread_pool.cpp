@@ -0,0 +1,51 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t numThreads) {
+    numThreads = max<size_t>(1, numThreads);
+    for (size_t i = 0; i < numThreads; ++i) workers_.emplace_back(&ThreadPool::workerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    taskReady_.notify_all();
+    for (auto &w : workers_) w.join();
+}
+
+void ThreadPool::submit(function<void()> task) {
+    {
+        lock_guard<mutex> lock(mutex_);
+        tasks_.push_back(move(task));
+    }
+    taskReady_.notify_one();
+}
+
+void ThreadPool::wait() {
+    unique_lock<mutex> lock(mutex_);
+    allDone_.wait(lock, [this] { return tasks_.empty() && running_ == 0; });
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> lock(mutex_);
+            taskReady_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;  // STOPPING AND DRAINED
+            task = move(tasks_.front());
+            tasks_.pop_front();
+            ++running_;
+        }
+        task();
+        {
+            lock_guard<mutex> lock(mutex_);
+            --running_;
+            if (tasks_.empty() && running_ == 0) allDone_.notify_all();
+        }
+    }
+}
@@ -0,0 +1,120 @@
+#include "tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include "porter2_stemmer.h"
+
+using namespace std;
+
+// STOP WORDS - LOWERCASE
+const set<string> STOP_WORDS = {
+    "the", "and", "is", "in", "to", "of", "that", "it", "for", "as", "with", 
+        "was", "this", "but", "be", "on", "by", "not", "he", "she", "or", "are", 
+        "at", "from", "his", "her", "they", "an", "will", "would", "which", "we"
+};
+
+// CLEAN A WORD: KEEP ONLY ALPHABETIC CHARS, CONVERT TO LOWERCASE
+string cleanWord(const string &word) {
+    string out;
+    out.reserve(word.size());
+    for (char c : word) {
+        if (isalpha(static_cast<unsigned char>(c))) {
+            out.push_back(static_cast<char>(tolower(static_cast<unsigned char>(c))));
+        }
+    }
+    return out;
+}
+
+// TOKENIZE TEXT: RETURN VECTOR OF (CLEANED_WORD, POSITION)
+vector<pair<string,int>> tokenizeWithPositions(const string &text) {
+    vector<pair<string,int>> tokens;
+    string token;
+    stringstream ss(text);
+    int pos = 0;
+    while (ss >> token) {
+        string cleaned = cleanWord(token);
+            if (cleaned.size() > 2 && STOP_WORDS.find(cleaned) == STOP_WORDS.end()) {
+                Porter2Stemmer::stem(cleaned); 
+                tokens.emplace_back(cleaned, pos);
+            }
+        pos++;
+    }
+    return tokens;
+}
+
+vector<TokenSpan> tokenByteSpans(const string &text) {
+    // SAME WORD BOUNDARIES AS THE stringstream >> SPLIT ABOVE
+    vector<TokenSpan> spans;
+    size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && isspace(static_cast<unsigned char>(text[i]))) ++i;
+        if (i == text.size()) break;
+        size_t start = i;
+        while (i < text.size() && !isspace(static_cast<unsigned char>(text[i]))) ++i;
+        size_t first = start, last = i;
+        while (first < last && !isalpha(static_cast<unsigned char>(text[first]))) ++first;
+        while (last > first && !isalpha(static_cast<unsigned char>(text[last - 1]))) --last;
+        if (first == last) {
+            first = start;
+            last = i;
+        }
+        spans.push_back({(uint32_t)first, (uint32_t)last});
+    }
+    return spans;
+}
+
+namespace {
+
+struct GramWord {
+    string form;   // CLEANED (COMMON) OR STEMMED; EMPTY IF NOTHING IS LEFT AFTER CLEANING
+    bool common;
+};
+
+// EVERY WHITESPACE-SEPARATED WORD, ONE PER POSITION
+vector<GramWord> gramWords(const string &text) {
+    vector<GramWord> words;
+    string token;
+    stringstream ss(text);
+    while (ss >> token) {
+        GramWord w{cleanWord(token), false};
+        if (!w.form.empty()) {
+            w.common = w.form.size() <= 2 || STOP_WORDS.find(w.form) != STOP_WORDS.end();
+            if (!w.common) Porter2Stemmer::stem(w.form);
+        }
+        words.push_back(move(w));
+    }
+    return words;
+}
+
+bool formsGram(const vector<GramWord> &words, size_t i) {
+    return i + 1 < words.size() && !words[i].form.empty() && !words[i + 1].form.empty() &&
+           (words[i].common || words[i + 1].common);
+}
+
+} // namespace
+
+bool isCommonGram(const string &term) {
+    return term.find(COMMON_GRAM_SEPARATOR) != string::npos;
+}
+
+vector<pair<string,int>> commonGramTokens(const string &text) {
+    vector<GramWord> words = gramWords(text);
+    vector<pair<string,int>> grams;
+    for (size_t i = 0; i + 1 < words.size(); ++i) {
+        if (formsGram(words, i)) grams.emplace_back(words[i].form + COMMON_GRAM_SEPARATOR + words[i + 1].form, (int)i);
+    }
+    return grams;
+}
+
+vector<pair<string,int>> commonGramPhraseTokens(const string &text) {
+    vector<GramWord> words = gramWords(text);
+    vector<pair<string,int>> tokens;
+    for (size_t i = 0; i < words.size(); ++i) {
+        if (formsGram(words, i)) {
+            tokens.emplace_back(words[i].form + COMMON_GRAM_SEPARATOR + words[i + 1].form, (int)i);
+        } else if (!words[i].form.empty() && !words[i].common && !(i > 0 && formsGram(words, i - 1))) {
+            tokens.emplace_back(words[i].form, (int)i);
+        }
+    }
+    return tokens;
+}
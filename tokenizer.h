@@ -0,0 +1,46 @@
+#ifndef _TOKENIZER_H_
+#define _TOKENIZER_H_
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// STOP WORDS - LOWERCASE
+extern const std::set<std::string> STOP_WORDS;
+
+// CLEAN A WORD: KEEP ONLY ALPHABETIC CHARS, CONVERT TO LOWERCASE
+std::string cleanWord(const std::string &word);
+
+// TOKENIZE TEXT: RETURN VECTOR OF (CLEANED_WORD, POSITION)
+// WORDS SHORTER THAN 3 CHARS AND STOP WORDS ARE DROPPED (BUT STILL COUNT AS POSITIONS),
+// THE REST ARE PORTER2-STEMMED
+std::vector<std::pair<std::string, int>> tokenizeWithPositions(const std::string &text);
+
+// BYTE RANGE [start, end) OF A WORD IN THE ORIGINAL TEXT
+struct TokenSpan {
+    uint32_t start;
+    uint32_t end;
+};
+
+// THE SPAN OF THE WORD AT EVERY POSITION tokenizeWithPositions COUNTS (INDEX = POSITION), TRIMMED
+// TO ITS FIRST AND LAST LETTER ("(happy," -> "happy"); A WORD WITHOUT LETTERS KEEPS ITS FULL SPAN
+std::vector<TokenSpan> tokenByteSpans(const std::string &text);
+
+// COMMON GRAMS: THE WORDS tokenizeWithPositions DROPS (STOP WORDS, WORDS UNDER 3 CHARS) ARE "COMMON".
+// EVERY PAIR OF ADJACENT WORDS WITH AT LEAST ONE COMMON WORD BECOMES A GRAM "first_second" AT THE
+// POSITION OF first (COMMON WORDS AS CLEANED, THE OTHERS STEMMED), E.G. "to be" -> "to_be".
+// GRAMS NEVER CONTAIN OTHER CHARACTERS THAN LETTERS AND ONE '_', SO THEY CANNOT CLASH WITH TERMS
+static const char COMMON_GRAM_SEPARATOR = '_';
+
+bool isCommonGram(const std::string &term);
+
+// THE GRAMS OF A DOCUMENT, INDEXED NEXT TO ITS tokenizeWithPositions TERMS
+std::vector<std::pair<std::string, int>> commonGramTokens(const std::string &text);
+
+// PHRASE TOKENS FOR AN INDEX WITH COMMON GRAMS: THE GRAMS OF THE TEXT PLUS EVERY NON-COMMON TERM NOT
+// ALREADY INSIDE A GRAM, ORDERED BY POSITION. STOP WORDS THEN CONSTRAIN THE MATCH EXACTLY
+std::vector<std::pair<std::string, int>> commonGramPhraseTokens(const std::string &text);
+
+#endif
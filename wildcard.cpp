@@ -0,0 +1,145 @@
+#include "wildcard.h"
+#include "intersect.h"
+#include "tokenizer.h"
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+// TERM BOUNDARY IN PADDED TRIGRAMS (TERMS NEVER CONTAIN A NUL BYTE)
+const char GRAM_PAD = '\0';
+
+uint32_t gramKey(const char *p) {
+    return (uint32_t)(uint8_t)p[0] << 16 | (uint32_t)(uint8_t)p[1] << 8 | (uint8_t)p[2];
+}
+
+void appendGrams(const string &padded, vector<uint32_t> &out) {
+    for (size_t i = 0; i + 3 <= padded.size(); ++i) out.push_back(gramKey(padded.data() + i));
+}
+
+} // namespace
+
+bool wildcardMatch(string_view pattern, string_view term) {
+    // GREEDY MATCH THAT BACKTRACKS TO THE LAST '*' (LINEAR FOR A SINGLE '*')
+    size_t p = 0, t = 0, star = string_view::npos, resume = 0;
+    while (t < term.size()) {
+        if (p < pattern.size() && pattern[p] == WILDCARD_CHAR) {
+            star = p++;
+            resume = t;
+        } else if (p < pattern.size() && pattern[p] == term[t]) {
+            ++p;
+            ++t;
+        } else if (star != string_view::npos) {
+            p = star + 1;
+            t = ++resume;
+        } else {
+            return false;
+        }
+    }
+    while (p < pattern.size() && pattern[p] == WILDCARD_CHAR) ++p;
+    return p == pattern.size();
+}
+
+TermTrigramIndex::TermTrigramIndex(const IndexReader &index) {
+    vector<pair<uint32_t, int>> postings;
+    vector<uint32_t> keys;
+    string padded;
+    for (int id = 0; id < index.termCount(); ++id) {
+        string_view term = index.term(id);
+        if (term.find(COMMON_GRAM_SEPARATOR) != string_view::npos) continue;
+        padded.assign(1, GRAM_PAD);
+        padded.append(term);
+        padded.push_back(GRAM_PAD);
+        keys.clear();
+        appendGrams(padded, keys);
+        sort(keys.begin(), keys.end());
+        keys.erase(unique(keys.begin(), keys.end()), keys.end());
+        for (uint32_t key : keys) postings.emplace_back(key, id);
+    }
+    sort(postings.begin(), postings.end());
+
+    termIds_.reserve(postings.size());
+    for (const auto &p : postings) {
+        if (grams_.empty() || grams_.back() != p.first) {
+            grams_.push_back(p.first);
+            starts_.push_back((uint32_t)termIds_.size());
+        }
+        termIds_.push_back(p.second);
+    }
+    starts_.push_back((uint32_t)termIds_.size());
+}
+
+bool TermTrigramIndex::candidates(string_view pattern, vector<int> &out) const {
+    out.clear();
+    // LITERAL PARTS BETWEEN THE '*'S, PADDED WHERE THEY ARE ANCHORED TO THE START / END OF THE TERM
+    vector<uint32_t> keys;
+    size_t start = 0;
+    while (start <= pattern.size()) {
+        size_t end = min(pattern.find(WILDCARD_CHAR, start), pattern.size());
+        string part(pattern.substr(start, end - start));
+        if (start == 0) part.insert(part.begin(), GRAM_PAD);
+        if (end == pattern.size()) part.push_back(GRAM_PAD);
+        appendGrams(part, keys);
+        start = end + 1;
+    }
+    if (keys.empty()) return false;
+    sort(keys.begin(), keys.end());
+    keys.erase(unique(keys.begin(), keys.end()), keys.end());
+
+    // INTERSECT THE TERM LISTS, SHORTEST FIRST
+    vector<pair<size_t, size_t>> lists;
+    for (uint32_t key : keys) {
+        auto it = lower_bound(grams_.begin(), grams_.end(), key);
+        if (it == grams_.end() || *it != key) return true;  // A TRIGRAM NO TERM HAS
+        size_t g = it - grams_.begin();
+        lists.emplace_back(starts_[g], starts_[g + 1]);
+    }
+    sort(lists.begin(), lists.end(),
+         [](const pair<size_t, size_t> &a, const pair<size_t, size_t> &b) { return a.second - a.first < b.second - b.first; });
+    out.assign(termIds_.begin() + lists[0].first, termIds_.begin() + lists[0].second);
+    for (size_t i = 1; i < lists.size() && !out.empty(); ++i) {
+        out.resize(intersectSorted(out.data(), out.size(), termIds_.data() + lists[i].first,
+                                   lists[i].second - lists[i].first, out.data()));
+    }
+    return true;
+}
+
+void capExpansion(const IndexReader &index, TermExpansion &expansion, size_t maxExpansions) {
+    auto &ids = expansion.termIds;
+    if (ids.size() <= maxExpansions) return;
+    partial_sort(ids.begin(), ids.begin() + maxExpansions, ids.end(), [&](int a, int b) {
+        uint32_t dfA = index.entry(a).df, dfB = index.entry(b).df;
+        return dfA != dfB ? dfA > dfB : a < b;
+    });
+    ids.resize(maxExpansions);
+    sort(ids.begin(), ids.end());
+    expansion.truncated = true;
+}
+
+TermExpansion expandWildcard(const IndexReader &index, string_view pattern, size_t maxExpansions) {
+    TermExpansion result;
+    // THE LITERAL PREFIX BOUNDS A CONTIGUOUS RANGE OF THE SORTED LEXICON (ALL OF IT IF EMPTY)
+    size_t star = pattern.find(WILDCARD_CHAR);
+    pair<int, int> range = index.prefixRange(pattern.substr(0, min(star, pattern.size())));
+    bool pureScan = star == string_view::npos || pattern.find_first_not_of(WILDCARD_CHAR, star) == string_view::npos;
+
+    auto keep = [&](int id) {
+        string_view term = index.term(id);
+        // '*' COULD OTHERWISE MATCH THE SEPARATOR OF A COMMON GRAM
+        if (term.find(COMMON_GRAM_SEPARATOR) == string_view::npos && wildcardMatch(pattern, term)) {
+            result.termIds.push_back(id);
+        }
+    };
+    vector<int> candidates;
+    if (!pureScan && index.termTrigrams().candidates(pattern, candidates) &&
+        candidates.size() < (size_t)(range.second - range.first)) {
+        for (int id : candidates) keep(id);
+    } else {
+        for (int id = range.first; id < range.second; ++id) keep(id);
+    }
+
+    capExpansion(index, result, maxExpansions);
+    return result;
+}
@@ -0,0 +1,57 @@
+#ifndef _WILDCARD_H_
+#define _WILDCARD_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "binary_index.h"
+
+// WILDCARD TERMS: A PATTERN OF LOWERCASE LETTERS WHERE '*' MATCHES ANY RUN OF CHARACTERS (ALSO
+// NONE), MATCHED AGAINST THE INDEXED (STEMMED) TERMS: optim* -> optim, optimis, optimum, ...
+//   PREFIX (optim*)       A RANGE SCAN OVER THE SORTED LEXICON
+//   ANY OTHER (*tion, o*m) A TRIGRAM INDEX OVER THE LEXICON NARROWS THE CANDIDATES, WHICH ARE THEN
+//                          CHECKED AGAINST THE PATTERN
+// COMMON GRAMS ARE NEVER EXPANDED TO
+
+static const char WILDCARD_CHAR = '*';
+
+// AT MOST THIS MANY TERMS PER EXPANDED PATTERN (WILDCARD OR FUZZY); BEYOND IT THE MOST FREQUENT ARE KEPT
+static const size_t TERM_EXPANSION_LIMIT = 512;
+// UP TO THIS MANY EXPANSIONS ARE MERGED WITH A HEAP OF CURSORS, MORE ARE UNIONED INTO ONE LIST
+static const size_t HEAP_UNION_MAX_TERMS = 16;
+
+// TRUE IF term MATCHES pattern
+bool wildcardMatch(std::string_view pattern, std::string_view term);
+
+// PADDED TRIGRAMS OF EVERY TERM ("optim" -> ^op opt pti tim im$) AS A COMPACT SORTED
+// TRIGRAM -> TERM IDS TABLE
+class TermTrigramIndex {
+public:
+    explicit TermTrigramIndex(const IndexReader &index);
+
+    // SORTED IDS OF THE TERMS HOLDING EVERY TRIGRAM OF THE PATTERN'S LITERAL PARTS (A SUPERSET OF THE
+    // MATCHES). RETURNS FALSE IF THE PATTERN HAS NO TRIGRAM TO LOOK UP
+    bool candidates(std::string_view pattern, std::vector<int> &out) const;
+
+    size_t gramCount() const { return grams_.size(); }
+
+private:
+    std::vector<uint32_t> grams_;   // DISTINCT TRIGRAM KEYS, SORTED
+    std::vector<uint32_t> starts_;  // TERMS OF grams_[g] ARE termIds_[starts_[g] .. starts_[g + 1])
+    std::vector<int> termIds_;
+};
+
+struct TermExpansion {
+    std::vector<int> termIds;  // ASCENDING
+    bool truncated = false;    // MORE TERMS MATCHED THAN maxExpansions
+};
+
+// KEEP THE maxExpansions TERMS WITH THE HIGHEST DF (TIES: LOWER TERM ID), STILL ASCENDING
+void capExpansion(const IndexReader &index, TermExpansion &expansion, size_t maxExpansions);
+
+// THE TERMS OF index MATCHING pattern
+TermExpansion expandWildcard(const IndexReader &index, std::string_view pattern,
+                             size_t maxExpansions = TERM_EXPANSION_LIMIT);
+
+#endif